@@ -47,4 +47,19 @@ static inline color_t IlluminanceOD_ColorFrom_Kelvin(float kelvin)
     return color;
 }
 
+static inline float IlluminanceOD_KelvinFrom_Color(color_t color)
+{
+    // Reverse IlluminanceOD_ColorFrom_Kelvin, red is saturated up to 6600K and then decreases
+    float temp;
+    if (color.r == 255)
+    {
+        temp = exp((color.g + 161.1195681661) / 99.4708025861);
+    }
+    else
+    {
+        temp = 60 + pow(color.r / 329.698727446, 1 / -0.1332047592);
+    }
+    return temp * 100;
+}
+
 #endif /* OD_OD_KELVIN_H_ */
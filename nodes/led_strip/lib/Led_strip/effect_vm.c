@@ -0,0 +1,349 @@
+/******************************************************************************
+ * @file effect vm
+ * @brief sandboxed bytecode interpreter computing led strip effects locally
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#include "effect_vm.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define FIX_ONE     0x10000
+#define FIX_QUARTER 0x4000
+
+typedef struct
+{
+    uint8_t pop;  // number of values taken from the stack
+    uint8_t push; // number of values put on the stack
+    uint8_t arg;  // number of argument bytes following the opcode
+} op_info_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+static const op_info_t op_info[OP_NB] = {
+    [OP_PUSH]   = {0, 1, 4},
+    [OP_INDEX]  = {0, 1, 0},
+    [OP_POS]    = {0, 1, 0},
+    [OP_COUNT]  = {0, 1, 0},
+    [OP_TIME]   = {0, 1, 0},
+    [OP_DUP]    = {1, 2, 0},
+    [OP_DROP]   = {1, 0, 0},
+    [OP_SWAP]   = {2, 2, 0},
+    [OP_OVER]   = {2, 3, 0},
+    [OP_ADD]    = {2, 1, 0},
+    [OP_SUB]    = {2, 1, 0},
+    [OP_MUL]    = {2, 1, 0},
+    [OP_DIV]    = {2, 1, 0},
+    [OP_MOD]    = {2, 1, 0},
+    [OP_NEG]    = {1, 1, 0},
+    [OP_ABS]    = {1, 1, 0},
+    [OP_MIN]    = {2, 1, 0},
+    [OP_MAX]    = {2, 1, 0},
+    [OP_FRAC]   = {1, 1, 0},
+    [OP_SIN]    = {1, 1, 0},
+    [OP_TRI]    = {1, 1, 0},
+    [OP_LT]     = {2, 1, 0},
+    [OP_SELECT] = {3, 1, 0},
+};
+
+// First quarter of a sine period in Q16.16, 64 steps
+static const int32_t sine_quarter[65] = {
+    0, 1608, 3216, 4821, 6424, 8022, 9616, 11204, 12785, 14359, 15924, 17479, 19024,
+    20557, 22078, 23586, 25080, 26558, 28020, 29466, 30893, 32303, 33692, 35062, 36410,
+    37736, 39040, 40320, 41576, 42806, 44011, 45190, 46341, 47464, 48559, 49624, 50660,
+    51665, 52639, 53581, 54491, 55368, 56212, 57022, 57798, 58538, 59244, 59914, 60547,
+    61145, 61705, 62228, 62714, 63162, 63572, 63944, 64277, 64571, 64827, 65043, 65220,
+    65358, 65457, 65516, 65536};
+
+static uint8_t program[EFFECT_MAX_PROGRAM_SIZE];
+static uint16_t program_size = 0;
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+static int32_t EffectVM_Mul(int32_t a, int32_t b);
+static int32_t EffectVM_Div(int32_t a, int32_t b);
+static int32_t EffectVM_Sin(int32_t turns);
+static int32_t EffectVM_SineQuarter(uint32_t phase);
+static uint8_t EffectVM_ToChannel(int32_t value);
+
+/******************************************************************************
+ * @brief check and load a new program, the previous one is kept if invalid
+ * @param program bytecode
+ * @param size of the program in bytes
+ * @return true if the program is running
+ ******************************************************************************/
+bool EffectVM_Load(const uint8_t *bytecode, uint16_t size)
+{
+    int depth = 0;
+    if ((size == 0) || (size > EFFECT_MAX_PROGRAM_SIZE))
+    {
+        return false;
+    }
+    // There is no jump so a single pass is enough to check every possible execution
+    for (uint16_t pc = 0; pc < size; pc += 1 + op_info[bytecode[pc]].arg)
+    {
+        if (bytecode[pc] >= OP_NB)
+        {
+            return false;
+        }
+        const op_info_t *info = &op_info[bytecode[pc]];
+        if ((pc + info->arg >= size) && (info->arg > 0))
+        {
+            return false;
+        }
+        if (depth < info->pop)
+        {
+            return false;
+        }
+        depth += info->push - info->pop;
+        if (depth > EFFECT_STACK_SIZE)
+        {
+            return false;
+        }
+    }
+    // We need a red, a green and a blue value at the end
+    if (depth != 3)
+    {
+        return false;
+    }
+    memcpy(program, bytecode, size);
+    program_size = size;
+    return true;
+}
+
+/******************************************************************************
+ * @brief stop the running program
+ * @param None
+ * @return None
+ ******************************************************************************/
+void EffectVM_Stop(void)
+{
+    program_size = 0;
+}
+
+/******************************************************************************
+ * @brief check if a program is running
+ * @param None
+ * @return true if a program is loaded
+ ******************************************************************************/
+bool EffectVM_IsRunning(void)
+{
+    return (program_size > 0);
+}
+
+/******************************************************************************
+ * @brief evaluate the program for each led
+ * @param matrix of colors to fill
+ * @param led_nb number of led to compute
+ * @param time_ms time since the program have been loaded
+ * @return None
+ ******************************************************************************/
+void EffectVM_Render(color_t *matrix, int led_nb, uint32_t time_ms)
+{
+    int32_t stack[EFFECT_STACK_SIZE];
+    // Stack usage have been checked at load time so there is no check here
+    int sp;
+    // Time and position steps are computed only once per refresh
+    const int32_t time     = (int32_t)(((uint64_t)time_ms << 16) / 1000);
+    const int32_t pos_step = (led_nb > 0) ? FIX_ONE / led_nb : 0;
+
+    for (int led = 0; led < led_nb; led++)
+    {
+        sp = 0;
+        for (uint16_t pc = 0; pc < program_size; pc++)
+        {
+            int32_t a, b;
+            switch (program[pc])
+            {
+                case OP_PUSH:
+                    memcpy(&stack[sp++], &program[pc + 1], sizeof(int32_t));
+                    pc += sizeof(int32_t);
+                    break;
+                case OP_INDEX:
+                    stack[sp++] = led << 16;
+                    break;
+                case OP_POS:
+                    stack[sp++] = led * pos_step;
+                    break;
+                case OP_COUNT:
+                    stack[sp++] = led_nb << 16;
+                    break;
+                case OP_TIME:
+                    stack[sp++] = time;
+                    break;
+                case OP_DUP:
+                    stack[sp] = stack[sp - 1];
+                    sp++;
+                    break;
+                case OP_DROP:
+                    sp--;
+                    break;
+                case OP_SWAP:
+                    a             = stack[sp - 1];
+                    stack[sp - 1] = stack[sp - 2];
+                    stack[sp - 2] = a;
+                    break;
+                case OP_OVER:
+                    stack[sp] = stack[sp - 2];
+                    sp++;
+                    break;
+                case OP_NEG:
+                    // The program is not trusted, compute unsigned to wrap on INT32_MIN instead of overflowing
+                    stack[sp - 1] = (int32_t)(0u - (uint32_t)stack[sp - 1]);
+                    break;
+                case OP_ABS:
+                    stack[sp - 1] = (stack[sp - 1] < 0) ? (int32_t)(0u - (uint32_t)stack[sp - 1]) : stack[sp - 1];
+                    break;
+                case OP_FRAC:
+                    stack[sp - 1] &= FIX_ONE - 1;
+                    break;
+                case OP_SIN:
+                    stack[sp - 1] = EffectVM_Sin(stack[sp - 1]);
+                    break;
+                case OP_TRI:
+                    a             = stack[sp - 1] & (FIX_ONE - 1);
+                    stack[sp - 1] = (a < FIX_ONE / 2) ? a * 2 : (FIX_ONE - a) * 2;
+                    break;
+                case OP_SELECT:
+                    sp -= 2;
+                    stack[sp - 1] = (stack[sp - 1] != 0) ? stack[sp] : stack[sp + 1];
+                    break;
+                default:
+                    // Binary operators
+                    b = stack[--sp];
+                    a = stack[sp - 1];
+                    switch (program[pc])
+                    {
+                        case OP_ADD:
+                            // Wrap around on overflow
+                            a = (int32_t)((uint32_t)a + (uint32_t)b);
+                            break;
+                        case OP_SUB:
+                            a = (int32_t)((uint32_t)a - (uint32_t)b);
+                            break;
+                        case OP_MUL:
+                            a = EffectVM_Mul(a, b);
+                            break;
+                        case OP_DIV:
+                            a = EffectVM_Div(a, b);
+                            break;
+                        case OP_MOD:
+                            // b == -1 would overflow on INT32_MIN and is always 0 anyway
+                            a = ((b != 0) && (b != -1)) ? a % b : 0;
+                            if (a < 0)
+                            {
+                                a = (int32_t)((uint32_t)a + ((b < 0) ? 0u - (uint32_t)b : (uint32_t)b));
+                            }
+                            break;
+                        case OP_MIN:
+                            a = (a < b) ? a : b;
+                            break;
+                        case OP_MAX:
+                            a = (a > b) ? a : b;
+                            break;
+                        case OP_LT:
+                            a = (a < b) ? FIX_ONE : 0;
+                            break;
+                        default:
+                            break;
+                    }
+                    stack[sp - 1] = a;
+                    break;
+            }
+        }
+        matrix[led].r = EffectVM_ToChannel(stack[0]);
+        matrix[led].g = EffectVM_ToChannel(stack[1]);
+        matrix[led].b = EffectVM_ToChannel(stack[2]);
+    }
+}
+
+/******************************************************************************
+ * @brief Q16.16 multiplication
+ * @param a, b operands
+ * @return a * b
+ ******************************************************************************/
+static int32_t EffectVM_Mul(int32_t a, int32_t b)
+{
+    return (int32_t)(((int64_t)a * b) >> 16);
+}
+
+/******************************************************************************
+ * @brief Q16.16 division saturating on a division by 0
+ * @param a, b operands
+ * @return a / b
+ ******************************************************************************/
+static int32_t EffectVM_Div(int32_t a, int32_t b)
+{
+    if (b == 0)
+    {
+        return (a < 0) ? INT32_MIN : INT32_MAX;
+    }
+    int64_t result = ((int64_t)a * FIX_ONE) / b;
+    if (result > INT32_MAX)
+    {
+        return INT32_MAX;
+    }
+    if (result < INT32_MIN)
+    {
+        return INT32_MIN;
+    }
+    return (int32_t)result;
+}
+
+/******************************************************************************
+ * @brief sine from the quarter table
+ * @param turns angle in Q16.16 turns
+ * @return sine in Q16.16
+ ******************************************************************************/
+static int32_t EffectVM_Sin(int32_t turns)
+{
+    // Only the fractional part of the turn matter
+    uint32_t phase = (uint32_t)turns & (FIX_ONE - 1);
+    switch (phase / FIX_QUARTER)
+    {
+        case 0:
+            return EffectVM_SineQuarter(phase);
+        case 1:
+            return EffectVM_SineQuarter(FIX_ONE / 2 - phase);
+        case 2:
+            return -EffectVM_SineQuarter(phase - FIX_ONE / 2);
+        default:
+            return -EffectVM_SineQuarter(FIX_ONE - phase);
+    }
+}
+
+/******************************************************************************
+ * @brief linear interpolation in the sine quarter table
+ * @param phase between 0 and FIX_QUARTER
+ * @return sine in Q16.16
+ ******************************************************************************/
+static int32_t EffectVM_SineQuarter(uint32_t phase)
+{
+    uint32_t index = phase >> 8;
+    if (index >= 64)
+    {
+        return FIX_ONE;
+    }
+    return sine_quarter[index] + (((sine_quarter[index + 1] - sine_quarter[index]) * (int32_t)(phase & 0xFF)) >> 8);
+}
+
+/******************************************************************************
+ * @brief convert a Q16.16 value between 0.0 and 1.0 into a color channel
+ * @param value to convert
+ * @return channel value between 0 and 255
+ ******************************************************************************/
+static uint8_t EffectVM_ToChannel(int32_t value)
+{
+    if (value <= 0)
+    {
+        return 0;
+    }
+    if (value >= FIX_ONE)
+    {
+        return 255;
+    }
+    return (uint8_t)((value * 255) >> 16);
+}
@@ -0,0 +1,72 @@
+/******************************************************************************
+ * @file effect vm
+ * @brief sandboxed bytecode interpreter computing led strip effects locally
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#ifndef EFFECT_VM_H
+#define EFFECT_VM_H
+
+#include "luos_engine.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define EFFECT_MAX_PROGRAM_SIZE 128
+#define EFFECT_STACK_SIZE       8
+
+/*
+ * A program is evaluated once for each led at each refresh and must leave
+ * exactly 3 values (red, green, blue) on the stack, 0.0 is off and 1.0 is full.
+ * All the values are Q16.16 fixed point numbers. There is no jump so a program
+ * always ends after at most EFFECT_MAX_PROGRAM_SIZE instructions, and the stack
+ * usage is checked when the program is loaded.
+ *
+ * Example, a red breathing light: TIME PUSH(0.5) MUL SIN PUSH(1) ADD PUSH(0.5) MUL PUSH(0) PUSH(0)
+ */
+typedef enum
+{
+    // Values
+    OP_PUSH,  // push the next 4 bytes as a little endian Q16.16 value
+    OP_INDEX, // push the led index
+    OP_POS,   // push the led position on the strip between 0.0 and 1.0
+    OP_COUNT, // push the number of led of the strip
+    OP_TIME,  // push the number of seconds since the program have been loaded
+    // Stack manipulation
+    OP_DUP,  // a -> a a
+    OP_DROP, // a ->
+    OP_SWAP, // a b -> b a
+    OP_OVER, // a b -> a b a
+    // Arithmetic
+    OP_ADD, // a b -> a + b
+    OP_SUB, // a b -> a - b
+    OP_MUL, // a b -> a * b
+    OP_DIV, // a b -> a / b (saturated if b is 0)
+    OP_MOD, // a b -> a modulo b, always positive
+    OP_NEG, // a -> -a
+    OP_ABS, // a -> |a|
+    OP_MIN, // a b -> min(a, b)
+    OP_MAX, // a b -> max(a, b)
+    OP_FRAC, // a -> fractional part of a
+    // Waves, the input is in turns so 1.0 is a full period
+    OP_SIN, // a -> sin(a * 2 * pi)
+    OP_TRI, // a -> triangle wave going from 0.0 to 1.0 and back to 0.0
+    // Conditions
+    OP_LT,     // a b -> 1.0 if a < b else 0.0
+    OP_SELECT, // c a b -> a if c is not 0.0 else b
+    OP_NB
+} effect_op_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+bool EffectVM_Load(const uint8_t *program, uint16_t size);
+void EffectVM_Stop(void);
+bool EffectVM_IsRunning(void);
+void EffectVM_Render(color_t *matrix, int led_nb, uint32_t time_ms);
+
+#endif /* EFFECT_VM_H */
@@ -6,21 +6,57 @@
  ******************************************************************************/
 #include "led_strip.h"
 #include "led_strip_drv.h"
+#include "effect_vm.h"
+#include "product_config.h"
 
 /*******************************************************************************
  * Definitions
  ******************************************************************************/
+#define EFFECT_REFRESH_MS 20
+// A frame older than the last displayed one by less than this is out of order,
+// further than that we consider that the sender restarted its sequence.
+#define FRAME_SEQ_WINDOW 64
+#define FRAME_RX_SIZE    (sizeof(frame_header_t) + FRAME_MAX_SPAN * sizeof(frame_span_t) + MAX_LED_NUMBER * sizeof(color_t))
+// Geometry of the strip sent to the light controler, the placement is let to the controler by default
+#ifndef LED_STRIP_LED_NB
+    #define LED_STRIP_LED_NB MAX_LED_NUMBER
+#endif
+#ifndef LED_STRIP_LENGTH_MM
+    #define LED_STRIP_LENGTH_MM 0
+#endif
+#ifndef LED_STRIP_FIRST_ANGLE_CDEG
+    #define LED_STRIP_FIRST_ANGLE_CDEG 0
+#endif
+#ifndef LED_STRIP_ANGLE_CDEG
+    #define LED_STRIP_ANGLE_CDEG 0
+#endif
 
 /*******************************************************************************
  * Variables
  ******************************************************************************/
 color_t matrix[MAX_LED_NUMBER];
-int imgsize = MAX_LED_NUMBER;
+color_t staged_matrix[MAX_LED_NUMBER];
+int imgsize = LED_STRIP_LED_NB;
+// Set on the first FRAME_COMMIT received, sequenced frames are then staged until the next commit
+bool sync_mode    = false;
+bool staged_ready = false;
+// Sequenced frames reception statistics, sent back to the frame source
+uint8_t frame_rx[FRAME_RX_SIZE];
+bool staged_sequenced = false;
+bool frame_receiving  = false;
+uint16_t staged_seq   = 0;
+uint16_t frame_source = 0;
+frame_ack_t frame_stat;
+// Effect program upload and time reference
+uint8_t effect_upload[EFFECT_MAX_PROGRAM_SIZE];
+uint32_t effect_start_ms = 0;
 
 /*******************************************************************************
  * Function
  ******************************************************************************/
 static void LedStrip_MsgHandler(service_t *service, msg_t *msg);
+static bool LedStrip_StageSpans(uint8_t *frame, int size);
+static void LedStrip_ApplyFrame(service_t *service);
 
 /******************************************************************************
  * @brief init must be call in project init
@@ -34,6 +70,8 @@ void LedStrip_Init(void)
     Luos_CreateService(LedStrip_MsgHandler, COLOR_TYPE, "led_strip", revision);
     // initialize color matrix with 0
     memset((void *)matrix, 0, MAX_LED_NUMBER * 3);
+    memset((void *)staged_matrix, 0, MAX_LED_NUMBER * 3);
+    memset((void *)&frame_stat, 0, sizeof(frame_ack_t));
     // initialize driver
     LedStripDrv_Init();
 }
@@ -44,6 +82,13 @@ void LedStrip_Init(void)
  ******************************************************************************/
 void LedStrip_Loop(void)
 {
+    static uint32_t last_effect_ms = 0;
+    // compute the running effect localy, without any message
+    if (EffectVM_IsRunning() && (Luos_GetSystick() - last_effect_ms >= EFFECT_REFRESH_MS))
+    {
+        last_effect_ms = Luos_GetSystick();
+        EffectVM_Render(matrix, imgsize, last_effect_ms - effect_start_ms);
+    }
     // write in buffer transfered through dma
     LedStripDrv_Write(matrix);
 }
@@ -57,30 +102,198 @@ static void LedStrip_MsgHandler(service_t *service, msg_t *msg)
 {
     if (msg->header.cmd == COLOR)
     {
+        // Any frame received stop the running effect
+        EffectVM_Stop();
+        // Frames are always staged to keep the staged matrix up to date with the displayed one
         // change led target color
         if (msg->header.size == 3)
         {
             // there is only one color copy it in the entire matrix
             for (int i = 0; i < imgsize; i++)
             {
-                memcpy((void *)matrix + (i * sizeof(color_t)), msg->data, sizeof(color_t));
+                memcpy((void *)staged_matrix + (i * sizeof(color_t)), msg->data, sizeof(color_t));
             }
+            staged_ready = true;
         }
         else
         {
             // image management
-            Luos_ReceiveData(service, msg, (void *)matrix);
+            // Never commit a frame still being received
+            staged_ready = (Luos_ReceiveData(service, msg, (void *)staged_matrix) > 0);
+        }
+        staged_sequenced = false;
+        // Only the sequenced frames are committed, frames from other senders are displayed at once even in sync mode
+        if (staged_ready)
+        {
+            LedStrip_ApplyFrame(service);
         }
         return;
     }
+    if (msg->header.cmd == COLOR_FRAME)
+    {
+        EffectVM_Stop();
+        if (msg->header.size > FRAME_RX_SIZE)
+        {
+            return;
+        }
+        if (!frame_receiving && staged_ready)
+        {
+            // A new frame arrive before the staged one have been displayed, they will be displayed together
+            frame_stat.dropped++;
+        }
+        int size = Luos_ReceiveData(service, msg, (void *)frame_rx);
+        frame_receiving = (size == 0);
+        if (size < 0)
+        {
+            // We missed a part of this frame
+            frame_stat.dropped++;
+            return;
+        }
+        if (size > 0)
+        {
+            frame_header_t *header = (frame_header_t *)frame_rx;
+            if ((msg->header.source != frame_source) || (header->seq == FRAME_SEQ_FIRST))
+            {
+                // A new sender or a restarted one (reboot, detection), its frames can't be older than the displayed one
+                frame_stat.last_seq = 0;
+            }
+            uint16_t age = frame_stat.last_seq - header->seq;
+            if ((frame_stat.last_seq != 0) && (age < FRAME_SEQ_WINDOW))
+            {
+                // This frame is older than the one displayed, ignore it
+                frame_stat.out_of_order++;
+                return;
+            }
+            if (!LedStrip_StageSpans(frame_rx, size))
+            {
+                // Malformed frame, we don't know what have been staged
+                frame_stat.dropped++;
+                return;
+            }
+            staged_seq       = header->seq;
+            frame_source     = msg->header.source;
+            staged_ready     = true;
+            staged_sequenced = true;
+            if (!sync_mode)
+            {
+                LedStrip_ApplyFrame(service);
+            }
+        }
+        return;
+    }
+    if (msg->header.cmd == FRAME_COMMIT)
+    {
+        // Display the staged frame, all the strips receive this broadcast at the same time
+        if (staged_ready)
+        {
+            LedStrip_ApplyFrame(service);
+        }
+        sync_mode = true;
+        return;
+    }
+    if (msg->header.cmd == EFFECT_PROGRAM)
+    {
+        // Do not receive programs bigger than what the VM can run
+        if (msg->header.size > EFFECT_MAX_PROGRAM_SIZE)
+        {
+            return;
+        }
+        int size = Luos_ReceiveData(service, msg, (void *)effect_upload);
+        if (size > 0)
+        {
+            // The program is checked before being run, an invalid one is ignored
+            if (EffectVM_Load(effect_upload, size))
+            {
+                effect_start_ms = Luos_GetSystick();
+            }
+        }
+        return;
+    }
+    if (msg->header.cmd == STRIP_GEOMETRY)
+    {
+        // Tell the light controler how this strip is made
+        strip_geometry_t geometry = {
+            .led_nb           = imgsize,
+            .length_mm        = LED_STRIP_LENGTH_MM,
+            .first_angle_cdeg = LED_STRIP_FIRST_ANGLE_CDEG,
+            .angle_cdeg       = LED_STRIP_ANGLE_CDEG,
+        };
+        msg_t pub_msg;
+        pub_msg.header.target_mode = SERVICEID;
+        pub_msg.header.target      = msg->header.source;
+        pub_msg.header.cmd         = STRIP_GEOMETRY;
+        pub_msg.header.size        = sizeof(strip_geometry_t);
+        memcpy(pub_msg.data, &geometry, sizeof(strip_geometry_t));
+        Luos_SendMsg(service, &pub_msg);
+        return;
+    }
     if (msg->header.cmd == PARAMETERS)
     {
         // set the led strip size
         short size;
         memcpy(&size, msg->data, sizeof(short));
         // resize by puting 0 in the end of the led strip
-        memset((void *)matrix + size, 0, (MAX_LED_NUMBER - size) * 3);
+        memset((void *)&matrix[size], 0, (MAX_LED_NUMBER - size) * 3);
+        memset((void *)&staged_matrix[size], 0, (MAX_LED_NUMBER - size) * 3);
         imgsize = size;
         return;
     }
 }
+
+/******************************************************************************
+ * @brief copy the spans of a received frame in the staged matrix
+ * @param frame received
+ * @param size of the frame
+ * @return false if the frame is malformed
+ ******************************************************************************/
+static bool LedStrip_StageSpans(uint8_t *frame, int size)
+{
+    frame_header_t header;
+    frame_span_t span;
+    int index = sizeof(frame_header_t);
+    if (size < (int)sizeof(frame_header_t))
+    {
+        return false;
+    }
+    memcpy(&header, frame, sizeof(frame_header_t));
+    for (uint8_t i = 0; i < header.span_nb; i++)
+    {
+        if (index + (int)sizeof(frame_span_t) > size)
+        {
+            return false;
+        }
+        memcpy(&span, &frame[index], sizeof(frame_span_t));
+        index += sizeof(frame_span_t);
+        if ((index + span.led_nb * (int)sizeof(color_t) > size) || (span.first_led + span.led_nb > MAX_LED_NUMBER))
+        {
+            return false;
+        }
+        // Only the leds changed since the previous frame are sent
+        memcpy((void *)&staged_matrix[span.first_led], &frame[index], span.led_nb * sizeof(color_t));
+        index += span.led_nb * sizeof(color_t);
+    }
+    return true;
+}
+
+/******************************************************************************
+ * @brief display the staged frame and acknowledge it if it was sequenced
+ * @param Service sending the acknowledgement
+ * @return None
+ ******************************************************************************/
+static void LedStrip_ApplyFrame(service_t *service)
+{
+    memcpy((void *)matrix, (void *)staged_matrix, imgsize * sizeof(color_t));
+    staged_ready = false;
+    if (staged_sequenced)
+    {
+        // Let the sender know what is displayed and how the frames are going
+        frame_stat.last_seq = staged_seq;
+        msg_t ack_msg;
+        ack_msg.header.target_mode = SERVICEID;
+        ack_msg.header.target      = frame_source;
+        ack_msg.header.cmd         = FRAME_ACK;
+        ack_msg.header.size        = sizeof(frame_ack_t);
+        memcpy(ack_msg.data, &frame_stat, sizeof(frame_ack_t));
+        Luos_SendMsg(service, &ack_msg);
+    }
+}
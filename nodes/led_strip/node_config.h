@@ -31,6 +31,8 @@
 /*******************************************************************************
  * PROJECT DEFINITION
  *******************************************************************************/
+#define LED_STRIP_LED_NB    74   // number of led of the strip
+#define LED_STRIP_LENGTH_MM 2450 // length of the strip
 
 /*******************************************************************************
  * LUOS LIBRARY DEFINITION
@@ -7,17 +7,45 @@
 #include "light_controler.h"
 #include "product_config.h"
 #include "od_kelvin.h"
+#include "light_render.h"
+#include "light_timing.h"
+#include "light_timeline.h"
+#include "light_preset.h"
+#include "light_log.h"
+#include "light_fsm.h"
+#include "light_tx.h"
+#include "light_filter.h"
+#include "light_predict.h"
+#include "timestamp.h"
 
 /*******************************************************************************
  * Definitions
  ******************************************************************************/
 #define BUTTON_STOP_PERIOS_MS   1000
 #define BUTTON_UPDATE_PERIOD_MS 50
+#define BUTTON_DOUBLE_PUSH_MS   400 // a short push this close to the previous one recalls the next preset over its mode switch
 #define POT_UPDATE_PERIOD_MS    20
-#define LED_STRIP_NB_LED        74
-#define LED_STRIP_SIZE_M        2.45
-#define FRAMERATE_MS            10
+#define POT_COURSE_DEG          300.0 // angle the potentiometer can go up to
+#define LED_STRIP_MAX_LED       150  // longest led strip driven
+#define LED_POOL_NB             300  // leds of all the led strips together
+#define LED_STRIP_MAX_NB        4    // led strips driven at the same time
+#define LIGHT_RADIUS_MAX_M      2.45 // radius of the light at the end of the potentiometer course
+#define LIGHT_KELVIN_MIN        1500 // color temperature at the start of the potentiometer course
+#define LIGHT_KELVIN_MAX        5500 // color temperature at the end of the potentiometer course
+#define SCENE_ANGLE_DEG         180  // angle covered by all the led strips together
+#define FRAMERATE_MS            10 // period of the desk loop, also the shortest frame interval
+#define FRAME_MAX_INTERVAL_MS   50 // longest frame interval while something still change
+#define FRAME_TARGET_STEP       4  // color step per frame the frame interval is adapted for
 #define RED_DOT_DURATION_MS     6000
+#define FRAME_ACK_TIMEOUT_MS    50
+#define GEOMETRY_RETRY_MS       500 // period of the geometry requests to the led strips that didn't answer yet
+#define FRAME_SPAN_GAP          1 // unchanged leds cheaper to send than a new span header
+#define OVERLAY_MAX_NB          4
+#define LIGHT_SPOT_NB           3 // independent spots rendered on the strip, the desk controls one of them at a time
+#define PRESET_TRANSITION_MS    1500 // duration of the transition to a recalled preset
+#define LIGHT_IDLE_MS           1000 // the light is idle when nothing have been rendered for this time
+#define FILTER_RED_DOT_GAP      (2 * Q16_ONE) // the red dot shows up while the light is this far from the potentiometer
+#define FRAME_TX_SIZE           (sizeof(frame_header_t) + FRAME_MAX_SPAN * sizeof(frame_span_t) + LED_STRIP_MAX_LED * sizeof(color_t))
 
 typedef enum
 {
@@ -27,61 +55,206 @@ typedef enum
     RADIUS_MODE,
     INTENSITY_MODE,
     COLOR_MODE,
+    DESK_MODE_NB
 } desk_mode_t;
 
+typedef enum
+{
+    DESK_EVENT_PUSH,        // short push on the button
+    DESK_EVENT_DOUBLE_PUSH, // 2 short pushes in a row, the first one also posted a DESK_EVENT_PUSH
+    DESK_EVENT_LONG_PUSH,   // button pushed for BUTTON_STOP_PERIOS_MS
+    DESK_EVENT_IDLE,        // the red dot is over, nothing moved for a while
+    DESK_EVENT_RECALL,      // a whole scene have been recalled
+    DESK_EVENT_REMOTE,      // a parameter have been set by a remote command
+    DESK_EVENT_NB
+} desk_event_t;
+
 typedef struct
 {
     angular_position_t angle; // angular position of the light between 0 and 180°
-    linear_position_t radius; // radius of the light between 0 and LED_STRIP_SIZE_M
+    linear_position_t radius; // radius of the light between 0 and LIGHT_RADIUS_MAX_M
     ratio_t intensity;        // intensity of the light between 0 and 100%
     color_t color;            // color of the light
+    uint8_t kernel;           // render_kernel_t falloff shape of the light
 } light_param_t;
 
 typedef struct
 {
     bool red_dot;
-    time_luos_t red_dot_date;
+    uint32_t red_dot_date; // tick the red dot have been displayed at
 } red_dot_t;
 
+typedef struct
+{
+    light_param_t param[LIGHT_SPOT_NB]; // scene the light is going to
+    uint8_t selected_spot;              // spot controlled by the desk
+    bool stopped;                       // the light have been stopped by the button
+} light_state_t;
+
 typedef void (*DESK_LOOP)(void);
 
 typedef struct
 {
-    desk_mode_t mode;
-    DESK_LOOP desk_loop;
-} desk_ctx_t;
+    bool last_state;       // button state of the previous message
+    bool pushed;           // a push may still become a long push
+    uint32_t push_date;    // tick of the last push
+    bool release_pending;  // a short push may still become a double push
+    bool second_push;      // the current push follows a short push
+    uint32_t release_date; // tick of the last short push release
+} button_ctx_t;
+
+typedef struct
+{
+    q16_t angle;     // center of the spot in degrees
+    q16_t radius;    // radius of the spot in meters
+    q16_t intensity; // intensity of the spot between 0 and Q16_ONE
+    color_t color;   // color of the spot at full intensity
+    uint8_t kernel;  // render_kernel_t falloff shape of the spot
+} scene_spot_t;
+
+typedef struct
+{
+    scene_spot_t spots[LIGHT_SPOT_NB]; // spots rendered
+    uint8_t selected;                  // spot displaying the red dot
+    desk_mode_t mode;                  // mode displayed by the red dot
+    q16_t dot_ratio;                   // red dot overlay ratio, 0 without red dot
+} render_key_t;
 
 typedef struct
 {
-    float prev_val;
-    float inertial_force;
-} filtering_ctx_t;
+    color_t *pixels;      // last rendered frame
+    color_t *sent_pixels; // last frame sent, the next one is sent as a difference from it
+    bool sent_valid;      // false to send the next frame entirely
+    uint16_t seq;         // sequence number of the last rendered frame
+    uint16_t sent_seq;    // sequence number of the last frame sent
+    bool pending;         // the frame have not been sent yet
+    bool in_flight;       // a frame have been sent and not acknowledged yet
+    bool staged;          // a frame have been sent and waits for the FRAME_COMMIT
+    uint32_t sent_date;   // systick of the last frame sent
+    frame_ack_t stat;     // last statistics received from the led strip
+    uint16_t superseded;  // frames replaced by a newer one before being sent
+} frame_ctx_t;
+
+typedef struct
+{
+    uint16_t id;                              // led strip service id
+    uint16_t led_nb;                          // number of led driven, 0 until the strip sent its geometry
+    q16_t first_angle;                        // angular position of the strip start in degrees
+    q16_t led_per_deg;                        // leds of the strip for each degree
+    q16_t led_per_m;                          // leds of the strip for each meter
+    frame_ctx_t frame;                        // frames of this strip
+    render_profile_t profiles[LIGHT_SPOT_NB]; // falloff weights cache of each spot on this strip
+} strip_ctx_t;
 
 /*******************************************************************************
  * Variables
  ******************************************************************************/
 // Parameters and variables
 static service_t *light_service;
-static light_param_t light_param;
-static light_param_t light_param_bak;
+static light_param_t light_param[LIGHT_SPOT_NB];
+static light_param_t light_param_bak[LIGHT_SPOT_NB];
+static uint8_t selected_spot = 0; // spot controlled by the desk
 static routing_table_t *potentiometer = NULL;
-static routing_table_t *led_strip     = NULL;
 static routing_table_t *button        = NULL;
 static angular_position_t raw_angle;
 static linear_position_t raw_radius;
 static ratio_t raw_intensity;
 static float raw_temperature;
+// Filters of the parameters controlled by the potentiometer, in degree, cm and percent
+static filter_t angle_filter;
+static filter_t radius_filter;
+static filter_t intensity_filter;
+// Potentiometer speed, the light is moved where the hand will be once the frame is displayed
+static predict_t pot_predict;
+static uint32_t display_latency_ms = 0; // time between a frame sent and its acknowledgement
 
-// Modes
-desk_ctx_t desk_ctx;
+// Modes, the state of the desk machine is its desk_mode_t
+static fsm_t desk_fsm;
+static button_ctx_t button_ctx;
 static red_dot_t red_dot_mode;
 
+// Led strips and frame transmission
+static strip_ctx_t strips[LED_STRIP_MAX_NB];
+static uint8_t strip_nb       = 0;
+static uint32_t geometry_date = 0; // systick of the last geometry request
+static uint8_t frame_tx[FRAME_TX_SIZE];
+// Buffers of the strips, shared depending on the geometry they sent
+static color_t render_pic[LED_STRIP_MAX_LED] __attribute__((aligned(4))); // picture being rendered
+static color_t pixel_pool[2 * LED_POOL_NB];                               // rendered and sent frames of each strip
+static uint16_t weight_pool[LIGHT_SPOT_NB * LED_POOL_NB];                 // falloff weights of each spot on each strip
+// Inputs of the last rendered frame, false when the frame have to be rendered anyway
+static render_key_t render_key;
+static bool render_valid       = false;
+static uint32_t frame_interval = FRAMERATE_MS; // time to wait between 2 rendered frames in ms
+static uint32_t render_date    = 0;            // systick of the last rendered frame
+// Presets
+static uint8_t current_preset = 0;     // last preset recalled
+static bool recall_active     = false; // the light is going to the recalled preset kept in light_param_bak
+static uint32_t recall_date   = 0;     // systick of the last recall
+
+// Keys of the parameters moved by a recall or a remote command, the timeline plays them from there
+static timeline_key_t param_keys[LIGHT_SPOT_NB][TIMELINE_CHANNEL_NB][2];
+
+// Time base of the controler, the systick is sampled once for each loop
+static uint32_t now_ms = 0;
+
+// Filters tuning, the angle follows the hand quickly but stays steady at rest
+static const filter_param_t angle_filter_param     = {.type = FILTER_ONE_EURO, .min_cutoff = Q16_ONE / 2, .beta = Q16_ONE / 20, .d_cutoff = Q16_ONE};
+static const filter_param_t radius_filter_param    = {.type = FILTER_SPRING, .time_ms = 300};
+static const filter_param_t intensity_filter_param = {.type = FILTER_EXPONENTIAL, .time_ms = 250};
+
+// Animations keys, angle in 1/100 degree, radius in mm, intensity in 1/100 percent and temperature in Kelvin
+static const timeline_key_t sunrise_intensity[] = {
+    {.date_ms = 0, .value = 0, .ease = TIMELINE_EASE_LINEAR},
+    {.date_ms = 600000, .value = 10000, .ease = TIMELINE_EASE_IN_OUT},
+};
+static const timeline_key_t sunrise_kelvin[] = {
+    {.date_ms = 0, .value = 1800, .ease = TIMELINE_EASE_LINEAR},
+    {.date_ms = 600000, .value = 5000, .ease = TIMELINE_EASE_OUT},
+};
+static const timeline_key_t sunrise_radius[] = {
+    {.date_ms = 0, .value = 200, .ease = TIMELINE_EASE_LINEAR},
+    {.date_ms = 600000, .value = 1200, .ease = TIMELINE_EASE_OUT},
+};
+static const timeline_key_t breathing_intensity[] = {
+    {.date_ms = 0, .value = 3000, .ease = TIMELINE_EASE_LINEAR},
+    {.date_ms = 2000, .value = 8000, .ease = TIMELINE_EASE_IN_OUT},
+    {.date_ms = 4000, .value = 3000, .ease = TIMELINE_EASE_IN_OUT},
+};
+
 /*******************************************************************************
  * Function
  ******************************************************************************/
 static void LightCtrl_MsgHandler(service_t *service, msg_t *msg);
 static void LightCtrl_UpdateLight(void);
-float LightCtrl_genericFiltering(filtering_ctx_t *f_ctx, float raw_val);
+static void LightCtrl_PlaceStrip(strip_ctx_t *strip, uint16_t led_nb, float length_m, float first_angle, float angle);
+static void LightCtrl_AllocateStrips(void);
+static void LightCtrl_AskGeometry(void);
+static void LightCtrl_RenderStrip(strip_ctx_t *strip, const render_key_t *key, color_t *pic);
+static void LightCtrl_SendFrame(void);
+static bool LightCtrl_SendStripFrame(strip_ctx_t *strip);
+static uint16_t LightCtrl_BuildFrame(strip_ctx_t *strip);
+static uint8_t LightCtrl_FrameStep(const strip_ctx_t *strip, const color_t *pic);
+static void LightCtrl_AdaptFrameRate(uint8_t step, uint32_t elapsed_ms, bool bus_busy);
+static uint8_t LightCtrl_RedDotLayers(const strip_ctx_t *strip, const render_key_t *key, const render_spot_t *spots, render_layer_t *layers, uint8_t layer_max);
+static uint8_t LightCtrl_DotLayers(render_layer_t *layers, uint8_t layer_max, const strip_ctx_t *strip, q16_t position, color_t color, q16_t opacity);
+static void LightCtrl_ShowRedDot(void);
+static void LightCtrl_PlayAnimation(uint8_t spot, light_animation_t animation);
+static void LightCtrl_ApplyTimeline(uint8_t spot, timeline_channel_t channel, int32_t value);
+static int32_t LightCtrl_ClampParam(timeline_channel_t channel, int32_t value);
+static bool LightCtrl_SetParam(const light_set_t *set);
+static void LightCtrl_MoveParam(uint8_t spot, timeline_channel_t channel, int32_t value, uint16_t duration_ms, uint8_t ease);
+static int32_t LightCtrl_ParamValue(const light_param_t *param, timeline_channel_t channel);
+static bool LightCtrl_SavePreset(uint8_t index);
+static bool LightCtrl_RecallPreset(uint8_t index);
+static bool LightCtrl_RecallNextPreset(void);
+static bool LightCtrl_Recalling(void);
+static const light_param_t *LightCtrl_Scene(void);
+static void LightCtrl_RestoreState(void);
+static void LightCtrl_LogState(void);
+static float LightCtrl_Filter(filter_t *filter, float raw_val, float scale, float max_val);
+static void LightCtrl_PotSample(msg_t *msg);
+static void LightCtrl_ResetFilters(void);
 
 // Loop pointer functions
 static void LightCtrl_angleFiltering(void);
@@ -92,7 +265,73 @@ static void LightCtrl_fadeLight(void);
 static void LightCtrl_doNothing(void);
 
 // Mode and state machine
-static void LightCtrl_modeSwitch(void);
+static void LightCtrl_ButtonEvents(bool state);
+static bool LightCtrl_StartLight(void);
+static bool LightCtrl_StopLight(void);
+static bool LightCtrl_ResumeLight(void);
+static bool LightCtrl_NextMode(void);
+
+// Loop of each mode
+static const DESK_LOOP desk_loops[DESK_MODE_NB] = {
+    [STOP_MODE]      = LightCtrl_fadeLight,
+    [START_MODE]     = LightCtrl_doNothing,
+    [ANGLE_MODE]     = LightCtrl_angleFiltering,
+    [RADIUS_MODE]    = LightCtrl_radiusFiltering,
+    [INTENSITY_MODE] = LightCtrl_intensityFiltering,
+    [COLOR_MODE]     = LightCtrl_doNothing,
+};
+
+// Desk transitions for each mode and event
+static const fsm_transition_t desk_transitions[DESK_MODE_NB][DESK_EVENT_NB] = {
+    [STOP_MODE] = {
+        [DESK_EVENT_PUSH]        = {LightCtrl_StartLight, INTENSITY_MODE},
+        [DESK_EVENT_DOUBLE_PUSH] = {LightCtrl_RecallNextPreset, START_MODE},
+        [DESK_EVENT_LONG_PUSH]   = {NULL, FSM_STAY},
+        [DESK_EVENT_IDLE]        = {NULL, FSM_STAY},
+        [DESK_EVENT_RECALL]      = {NULL, START_MODE},
+        [DESK_EVENT_REMOTE]      = {LightCtrl_ResumeLight, START_MODE},
+    },
+    [START_MODE] = {
+        [DESK_EVENT_PUSH]        = {LightCtrl_NextMode, INTENSITY_MODE},
+        [DESK_EVENT_DOUBLE_PUSH] = {LightCtrl_RecallNextPreset, START_MODE},
+        [DESK_EVENT_LONG_PUSH]   = {LightCtrl_StopLight, STOP_MODE},
+        [DESK_EVENT_IDLE]        = {NULL, FSM_STAY},
+        [DESK_EVENT_RECALL]      = {NULL, START_MODE},
+        [DESK_EVENT_REMOTE]      = {NULL, START_MODE},
+    },
+    [ANGLE_MODE] = {
+        [DESK_EVENT_PUSH]        = {LightCtrl_NextMode, INTENSITY_MODE},
+        [DESK_EVENT_DOUBLE_PUSH] = {LightCtrl_RecallNextPreset, START_MODE},
+        [DESK_EVENT_LONG_PUSH]   = {LightCtrl_StopLight, STOP_MODE},
+        [DESK_EVENT_IDLE]        = {NULL, START_MODE},
+        [DESK_EVENT_RECALL]      = {NULL, START_MODE},
+        [DESK_EVENT_REMOTE]      = {NULL, START_MODE},
+    },
+    [RADIUS_MODE] = {
+        [DESK_EVENT_PUSH]        = {LightCtrl_NextMode, COLOR_MODE},
+        [DESK_EVENT_DOUBLE_PUSH] = {LightCtrl_RecallNextPreset, START_MODE},
+        [DESK_EVENT_LONG_PUSH]   = {LightCtrl_StopLight, STOP_MODE},
+        [DESK_EVENT_IDLE]        = {NULL, START_MODE},
+        [DESK_EVENT_RECALL]      = {NULL, START_MODE},
+        [DESK_EVENT_REMOTE]      = {NULL, START_MODE},
+    },
+    [INTENSITY_MODE] = {
+        [DESK_EVENT_PUSH]        = {LightCtrl_NextMode, RADIUS_MODE},
+        [DESK_EVENT_DOUBLE_PUSH] = {LightCtrl_RecallNextPreset, START_MODE},
+        [DESK_EVENT_LONG_PUSH]   = {LightCtrl_StopLight, STOP_MODE},
+        [DESK_EVENT_IDLE]        = {NULL, START_MODE},
+        [DESK_EVENT_RECALL]      = {NULL, START_MODE},
+        [DESK_EVENT_REMOTE]      = {NULL, START_MODE},
+    },
+    [COLOR_MODE] = {
+        [DESK_EVENT_PUSH]        = {LightCtrl_NextMode, ANGLE_MODE},
+        [DESK_EVENT_DOUBLE_PUSH] = {LightCtrl_RecallNextPreset, START_MODE},
+        [DESK_EVENT_LONG_PUSH]   = {LightCtrl_StopLight, STOP_MODE},
+        [DESK_EVENT_IDLE]        = {NULL, FSM_STAY},
+        [DESK_EVENT_RECALL]      = {NULL, START_MODE},
+        [DESK_EVENT_REMOTE]      = {NULL, START_MODE},
+    },
+};
 
 /******************************************************************************
  * @brief init must be call in project init
@@ -106,27 +345,59 @@ void LightCtrl_Init(void)
     light_service = Luos_CreateService(LightCtrl_MsgHandler, LIGHT_CONTROLER_APP, "Controler", revision);
 
     // ******************* Light parameters initialization *******************
-    light_param.angle     = AngularOD_PositionFrom_deg(90.0);
-    light_param.radius    = LinearOD_PositionFrom_m(0.5);
-    light_param.intensity = RatioOD_RatioFrom_Percent(25.0);
+    light_param[0].angle     = AngularOD_PositionFrom_deg(90.0);
+    light_param[0].radius    = LinearOD_PositionFrom_m(0.5);
+    light_param[0].intensity = RatioOD_RatioFrom_Percent(25.0);
     // Start with a 4500K color temperature
-    light_param.color.r = 255;
-    light_param.color.g = 196;
-    light_param.color.b = 137;
+    light_param[0].color.r = 255;
+    light_param[0].color.g = 196;
+    light_param[0].color.b = 137;
+    light_param[0].kernel  = RENDER_KERNEL_LINEAR;
+    // The other spots are the same but switched off
+    for (uint8_t i = 1; i < LIGHT_SPOT_NB; i++)
+    {
+        light_param[i]           = light_param[0];
+        light_param[i].intensity = RatioOD_RatioFrom_Percent(0.0);
+    }
+    selected_spot = 0;
 
-    light_param_bak = light_param;
+    memcpy(light_param_bak, light_param, sizeof(light_param));
 
-    raw_angle       = light_param.angle;
-    raw_radius      = light_param.radius;
+    raw_angle       = light_param[selected_spot].angle;
+    raw_radius      = light_param[selected_spot].radius;
     raw_intensity   = RatioOD_RatioFrom_Percent(0.0);
     raw_temperature = 3500.0f;
 
-    red_dot_mode.red_dot      = true;
-    red_dot_mode.red_dot_date = TimeOD_TimeFrom_ms(Luos_GetSystick());
+    now_ms = Luos_GetSystick();
+    LightCtrl_ShowRedDot();
+
+    memset(strips, 0, sizeof(strips));
+    strip_nb       = 0;
+    frame_interval = FRAMERATE_MS;
+    LightTiming_Init(FRAMERATE_MS * 1000);
+    LightTimeline_Init();
+    LightTx_Init();
+
+    // ******************* presets initialization *******************
+    LUOS_ASSERT(sizeof(light_param) <= PRESET_DATA_SIZE);
+    LightPreset_Init();
+    recall_active = false;
+    // The first recall from the button goes to the first preset
+    current_preset = PRESET_NB - 1;
 
     // ******************* context initialization *******************
-    desk_ctx.mode      = STOP_MODE;
-    desk_ctx.desk_loop = LightCtrl_fadeLight;
+    LightFilter_Init(&angle_filter, &angle_filter_param);
+    LightFilter_Init(&radius_filter, &radius_filter_param);
+    LightFilter_Init(&intensity_filter, &intensity_filter_param);
+    LightPredict_Init(&pot_predict);
+    display_latency_ms = 0;
+    LightFsm_Init(&desk_fsm, &desk_transitions[0][0], DESK_EVENT_NB, STOP_MODE);
+    memset(&button_ctx, 0, sizeof(button_ctx_t));
+
+    // ******************* last state restoration *******************
+    LightLog_Init();
+    LightCtrl_RestoreState();
+    LightCtrl_ResetFilters();
 
     // ******************* service detection *******************
     Luos_Detect(light_service);
@@ -140,11 +411,35 @@ void LightCtrl_Init(void)
 void LightCtrl_Loop(void)
 {
     static uint32_t lastframe_time_ms = 0;
-    if (Luos_GetSystick() - lastframe_time_ms >= FRAMERATE_MS)
+    // Sample the time once, everything done until the next loop happen at this date
+    now_ms = Luos_GetSystick();
+    // Send the messages queued since the last loop before any new frame
+    LightTx_Loop(light_service);
+    // Change mode depending on the events received since the last loop
+    LightFsm_Dispatch(&desk_fsm);
+    // Ask again the geometry lost on the bus, the strips are not displayed without it
+    if (now_ms - geometry_date >= GEOMETRY_RETRY_MS)
     {
-        lastframe_time_ms = Luos_GetSystick();
-        desk_ctx.desk_loop();
+        LightCtrl_AskGeometry();
+    }
+    if (now_ms - lastframe_time_ms >= FRAMERATE_MS)
+    {
+        lastframe_time_ms = now_ms;
+        LightTiming_FrameStart();
+        desk_loops[desk_fsm.state]();
+        if (!red_dot_mode.red_dot)
+        {
+            // Go back to the start mode if nothing moves
+            LightFsm_Post(&desk_fsm, DESK_EVENT_IDLE);
+        }
+        // Log the light state, a little bit of flash is written at each frame and counts in its budget
+        LightTiming_StageStart(TIMING_LOG);
+        LightCtrl_LogState();
+        LightTiming_StageEnd(TIMING_LOG);
+        LightTiming_FrameEnd();
     }
+    // Send the last frame as soon as the led strip is ready for it
+    LightCtrl_SendFrame();
 }
 /******************************************************************************
  * @brief Msg Handler call back when a msg receive for this service
@@ -155,30 +450,32 @@ void LightCtrl_Loop(void)
  ******************************************************************************/
 static void LightCtrl_MsgHandler(service_t *service, msg_t *msg)
 {
+    // Nothing is sent from here, the answers are queued and sent by light_service from the loop
+    (void)service;
     if (msg->header.cmd == ANGULAR_POSITION)
     {
         float delta = 0.0;
         ratio_t temp;
-        switch (desk_ctx.mode)
+        LightCtrl_PotSample(msg);
+        switch (desk_fsm.state)
         {
             case ANGLE_MODE:
                 // Save the new raw angular position
                 AngularOD_PositionFromMsg(&raw_angle, msg);
                 // We want the potentiometer to give a value between 0 and 180°
                 // We need to convert the raw value to this range knowing that my potentiometer can go up to 300°
-                raw_angle = AngularOD_PositionFrom_deg(AngularOD_PositionTo_deg(raw_angle) * 180.0 / 300.0);
+                raw_angle = AngularOD_PositionFrom_deg(AngularOD_PositionTo_deg(raw_angle) * 180.0 / POT_COURSE_DEG);
                 break;
             case RADIUS_MODE:
                 // Save the new raw radius position
                 LinearOD_PositionFromMsg(&raw_radius, msg);
-                // We want the potentiometer to give a value between 0 and LED_STRIP_SIZE_M
+                // We want the potentiometer to give a value between 0 and LIGHT_RADIUS_MAX_M
                 // We need to convert the raw value to this range knowing that my potentiometer can go up to 300°
-                raw_radius = LinearOD_PositionFrom_m(LinearOD_PositionTo_m(raw_radius) * LED_STRIP_SIZE_M / 300.0);
-                delta      = fabs(LinearOD_PositionTo_m(raw_radius) - LinearOD_PositionTo_m(light_param.radius));
+                raw_radius = LinearOD_PositionFrom_m(LinearOD_PositionTo_m(raw_radius) * LIGHT_RADIUS_MAX_M / POT_COURSE_DEG);
+                delta      = fabs(LinearOD_PositionTo_m(raw_radius) - LinearOD_PositionTo_m(light_param[selected_spot].radius));
                 if (delta > 0.01)
                 {
-                    red_dot_mode.red_dot      = true;
-                    red_dot_mode.red_dot_date = TimeOD_TimeFrom_ms(Luos_GetSystick());
+                    LightCtrl_ShowRedDot();
                 }
                 break;
             case INTENSITY_MODE:
@@ -186,12 +483,11 @@ static void LightCtrl_MsgHandler(service_t *service, msg_t *msg)
                 RatioOD_RatioFromMsg(&raw_intensity, msg);
                 // We want the potentiometer to give a value between 0 and 100%
                 // We need to convert the raw value to this range knowing that my potentiometer can go up to 300°
-                raw_intensity = RatioOD_RatioFrom_Percent(RatioOD_RatioTo_Percent(raw_intensity) * 100.0 / 300.0);
-                delta         = fabs(RatioOD_RatioTo_Percent(raw_intensity) - RatioOD_RatioTo_Percent(light_param.intensity));
+                raw_intensity = RatioOD_RatioFrom_Percent(RatioOD_RatioTo_Percent(raw_intensity) * 100.0 / POT_COURSE_DEG);
+                delta         = fabs(RatioOD_RatioTo_Percent(raw_intensity) - RatioOD_RatioTo_Percent(light_param[selected_spot].intensity));
                 if (delta > 0.5)
                 {
-                    red_dot_mode.red_dot      = true;
-                    red_dot_mode.red_dot_date = TimeOD_TimeFrom_ms(Luos_GetSystick());
+                    LightCtrl_ShowRedDot();
                 }
                 break;
             case COLOR_MODE:
@@ -201,12 +497,11 @@ static void LightCtrl_MsgHandler(service_t *service, msg_t *msg)
                 RatioOD_RatioFromMsg(&temp, msg);
                 if (fabs((RatioOD_RatioTo_Percent(temp) * 4000.0 / 100.0 + 1500.0) - raw_temperature) > 200.0)
                 {
-                    red_dot_mode.red_dot      = true;
-                    red_dot_mode.red_dot_date = TimeOD_TimeFrom_ms(Luos_GetSystick());
+                    LightCtrl_ShowRedDot();
                 }
                 raw_temperature = RatioOD_RatioTo_Percent(temp) * 4000.0 / 100.0 + 1500.0;
                 // Directly apply the temperature to the light
-                light_param.color = IlluminanceOD_ColorFrom_Kelvin(raw_temperature);
+                light_param[selected_spot].color = IlluminanceOD_ColorFrom_Kelvin(raw_temperature);
                 break;
 
             default:
@@ -216,57 +511,172 @@ static void LightCtrl_MsgHandler(service_t *service, msg_t *msg)
     }
     if (msg->header.cmd == IO_STATE)
     {
-        static bool last_state            = false;
-        static time_luos_t last_push_date = {0.0};
-        bool state                        = (bool)msg->data[0];
-        //
-        if (state != last_state)
+        LightCtrl_ButtonEvents((bool)msg->data[0]);
+        return;
+    }
+    if (msg->header.cmd == SPOT_KERNEL)
+    {
+        // Select the falloff shape of the controlled spot, its weights are computed once on the next frame
+        if ((msg->header.size >= sizeof(uint8_t)) && (msg->data[0] < RENDER_KERNEL_NB))
         {
-            if (state)
-            {
-                // Someone start pushing the button, start measuring time
-                last_push_date = TimeOD_TimeFrom_ms(Luos_GetSystick());
-            }
-            else
+            light_param[selected_spot].kernel = msg->data[0];
+        }
+        return;
+    }
+    if (msg->header.cmd == SPOT_SELECT)
+    {
+        // Select the spot controlled by the desk
+        if ((msg->header.size >= sizeof(uint8_t)) && (msg->data[0] < LIGHT_SPOT_NB))
+        {
+            selected_spot = msg->data[0];
+            // The filters of the previous spot would make this one jump to its values, restart them from this spot.
+            // It then smoothly goes to the absolute potentiometer position on the next potentiometer message.
+            raw_angle     = light_param[selected_spot].angle;
+            raw_radius    = light_param[selected_spot].radius;
+            raw_intensity = light_param[selected_spot].intensity;
+            LightCtrl_ResetFilters();
+            LightCtrl_ShowRedDot();
+        }
+        return;
+    }
+    if (msg->header.cmd == ANIMATION_PLAY)
+    {
+        if (msg->header.size < sizeof(animation_cmd_t))
+        {
+            return;
+        }
+        animation_cmd_t animation;
+        memcpy(&animation, msg->data, sizeof(animation_cmd_t));
+        if ((animation.spot < LIGHT_SPOT_NB) && (animation.animation < ANIMATION_NB))
+        {
+            LightCtrl_PlayAnimation(animation.spot, animation.animation);
+        }
+        return;
+    }
+    if (msg->header.cmd == PRESET_SAVE)
+    {
+        // An empty message would erase the preset page for a random index
+        if (msg->header.size >= sizeof(uint8_t))
+        {
+            LightCtrl_SavePreset(msg->data[0]);
+        }
+        return;
+    }
+    if (msg->header.cmd == PRESET_RECALL)
+    {
+        if ((msg->header.size >= sizeof(uint8_t)) && LightCtrl_RecallPreset(msg->data[0]))
+        {
+            LightFsm_Post(&desk_fsm, DESK_EVENT_RECALL);
+        }
+        return;
+    }
+    if (msg->header.cmd == LIGHT_SET)
+    {
+        if (msg->header.size < sizeof(light_set_t))
+        {
+            return;
+        }
+        // Set a parameter without going through the potentiometer filters
+        light_set_t set;
+        memcpy(&set, msg->data, sizeof(light_set_t));
+        if (LightCtrl_SetParam(&set))
+        {
+            // Leave the potentiometer control, it would move the parameter back
+            LightFsm_Post(&desk_fsm, DESK_EVENT_REMOTE);
+        }
+        return;
+    }
+    if (msg->header.cmd == GET_CMD)
+    {
+        // Send the frame timings measured since the last request
+        msg_t pub_msg;
+        timing_report_t report;
+        LightTiming_Report(&report);
+        pub_msg.header.target_mode = SERVICEID;
+        pub_msg.header.target      = msg->header.source;
+        pub_msg.header.cmd         = FRAME_TIMING;
+        pub_msg.header.size        = sizeof(timing_report_t);
+        memcpy(pub_msg.data, &report, sizeof(timing_report_t));
+        LightTx_Push(&pub_msg, TX_PRIORITY_REPLY);
+        return;
+    }
+    if (msg->header.cmd == FRAME_ACK)
+    {
+        if (msg->header.size < sizeof(frame_ack_t))
+        {
+            return;
+        }
+        for (uint8_t i = 0; i < strip_nb; i++)
+        {
+            if (strips[i].id == msg->header.source)
             {
-                // Someone stop pushing the button, check if it was short enough to not stop the light
-                if (TimeOD_TimeTo_ms(last_push_date) > 0.01)
+                frame_ctx_t *frame = &strips[i].frame;
+                memcpy(&frame->stat, msg->data, sizeof(frame_ack_t));
+                // Compare with the last frame sent, not the last rendered one: a newer frame is usually pending while the light moves
+                if (frame->stat.last_seq == frame->sent_seq)
                 {
-                    // The button was released before the end of the BUTTON_STOP_PERIOS_MS, we have to use it as a mode switch
-                    LightCtrl_modeSwitch();
-                    red_dot_mode.red_dot      = true;
-                    red_dot_mode.red_dot_date = TimeOD_TimeFrom_ms(Luos_GetSystick());
-                    // Reset time to avoid stopping the light
-                    last_push_date = TimeOD_TimeFrom_ms(0.0);
+                    // Average the time the led strips take to display a frame
+                    uint32_t latency_ms = Luos_GetSystick() - frame->sent_date;
+                    display_latency_ms  = (3 * display_latency_ms + latency_ms) / 4;
+                    // The led strip displayed the last frame sent, we can send the next one
+                    frame->in_flight = false;
                 }
             }
-            last_state = state;
         }
-        if ((TimeOD_TimeTo_ms(last_push_date) > 0.01)
-            && (Luos_GetSystick() - TimeOD_TimeTo_ms(last_push_date) > BUTTON_STOP_PERIOS_MS)
-            && (desk_ctx.mode != STOP_MODE))
+        return;
+    }
+    if (msg->header.cmd == STRIP_GEOMETRY)
+    {
+        if (msg->header.size < sizeof(strip_geometry_t))
+        {
+            return;
+        }
+        strip_geometry_t geometry;
+        memcpy(&geometry, msg->data, sizeof(strip_geometry_t));
+        for (uint8_t i = 0; i < strip_nb; i++)
         {
-            // The button is still pushed after the BUTTON_STOP_PERIOS_MS. We have to stop the light
-            light_param_bak    = light_param;
-            desk_ctx.mode      = STOP_MODE;
-            desk_ctx.desk_loop = LightCtrl_fadeLight;
-            last_push_date     = TimeOD_TimeFrom_ms(0.0);
+            if (strips[i].id == msg->header.source)
+            {
+                if (geometry.angle_cdeg == 0)
+                {
+                    // The strip let us place it, strips share the scene angle evenly in detection order
+                    LightCtrl_PlaceStrip(&strips[i], geometry.led_nb, geometry.length_mm / 1000.0f,
+                                         (float)SCENE_ANGLE_DEG * i / strip_nb, (float)SCENE_ANGLE_DEG / strip_nb);
+                }
+                else
+                {
+                    LightCtrl_PlaceStrip(&strips[i], geometry.led_nb, geometry.length_mm / 1000.0f,
+                                         geometry.first_angle_cdeg / 100.0f, geometry.angle_cdeg / 100.0f);
+                }
+                // The buffers of the strips depend on their size, render and send the next frame entirely
+                LightCtrl_AllocateStrips();
+                render_valid = false;
+            }
         }
         return;
     }
     if (msg->header.cmd == END_DETECTION)
     {
         search_result_t target_list;
+        // The led strips may have been restarted, render and send the next frame entirely
+        render_valid = false;
         // Get the first potentiometer
         RTFilter_Reset(&target_list);
         RTFilter_Type(&target_list, ANGLE_TYPE);
         LUOS_ASSERT(target_list.result_nbr > 0);
         potentiometer = target_list.result_table[0];
-        // Get the first led strip
+        // Get every led strip, they are not displayed until they sent their geometry
         RTFilter_Reset(&target_list);
         RTFilter_Type(&target_list, COLOR_TYPE);
         LUOS_ASSERT(target_list.result_nbr > 0);
-        led_strip = target_list.result_table[0];
+        strip_nb = (target_list.result_nbr > LED_STRIP_MAX_NB) ? LED_STRIP_MAX_NB : target_list.result_nbr;
+        memset(strips, 0, sizeof(strips));
+        for (uint8_t i = 0; i < strip_nb; i++)
+        {
+            strips[i].id = target_list.result_table[i]->id;
+            // The next frame restarts the sequence, the strip accepts it whatever it displayed before
+            strips[i].frame.seq = FRAME_SEQ_FIRST - 1;
+        }
         // Get the first button
         RTFilter_Reset(&target_list);
         RTFilter_Type(&target_list, STATE_TYPE);
@@ -283,8 +693,7 @@ static void LightCtrl_MsgHandler(service_t *service, msg_t *msg)
         time_luos_t time = TimeOD_TimeFrom_ms(POT_UPDATE_PERIOD_MS);
         TimeOD_TimeToMsg(&time, &send_msg);
         send_msg.header.cmd = UPDATE_PUB;
-        while (Luos_SendMsg(service, &send_msg) != SUCCEED)
-            ;
+        LightTx_Push(&send_msg, TX_PRIORITY_CONFIG);
 
         // Setup auto update each BUTTON_UPDATE_PERIOD_MS on the button
         // This value is resetted on all service at each detection
@@ -295,8 +704,10 @@ static void LightCtrl_MsgHandler(service_t *service, msg_t *msg)
         time = TimeOD_TimeFrom_ms(BUTTON_UPDATE_PERIOD_MS);
         TimeOD_TimeToMsg(&time, &send_msg);
         send_msg.header.cmd = UPDATE_PUB;
-        while (Luos_SendMsg(service, &send_msg) != SUCCEED)
-            ;
+        LightTx_Push(&send_msg, TX_PRIORITY_CONFIG);
+
+        // Ask each led strip for its geometry, the loop asks again the strips that don't answer
+        LightCtrl_AskGeometry();
 
         return;
     }
@@ -310,135 +721,590 @@ static void LightCtrl_MsgHandler(service_t *service, msg_t *msg)
  ******************************************************************************/
 static void LightCtrl_UpdateLight(void)
 {
-    // Compute the picture depending on the light parameters
-    color_t pic[LED_STRIP_NB_LED] = {0};
-    volatile float center_led     = AngularOD_PositionTo_deg(light_param.angle) * LED_STRIP_NB_LED / 180.0;
-    volatile float radius_led     = LinearOD_PositionTo_m(light_param.radius) * LED_STRIP_NB_LED / LED_STRIP_SIZE_M;
-    volatile int first_led;
-    volatile int second_led;
-    for (uint8_t i = 0; i < LED_STRIP_NB_LED; i++)
+    // Animated parameters follow their tracks, over the desk inputs
+    LightTimeline_Update(now_ms, LightCtrl_ApplyTimeline);
+
+    // Convert the light parameters into fixed point once for the whole frame
+    render_key_t key;
+    memset(&key, 0, sizeof(render_key_t));
+    for (uint8_t i = 0; i < LIGHT_SPOT_NB; i++)
     {
-        // Compute the led number between the led and the center
-        float led_diff = fabs(center_led - i);
-        // Compute the light intentisty depending on the radius
-        float intensity = (1.0f - (led_diff / radius_led))
-                          * RatioOD_RatioTo_Percent(light_param.intensity) / 100.0f;
-        if (intensity < 0.0)
-        {
-            intensity = 0.0;
-        }
-        pic[i].r = light_param.color.r * intensity;
-        pic[i].g = light_param.color.g * intensity;
-        pic[i].b = light_param.color.b * intensity;
+        key.spots[i].angle     = AngularOD_PositionTo_deg(light_param[i].angle) * Q16_ONE;
+        key.spots[i].radius    = LinearOD_PositionTo_m(light_param[i].radius) * Q16_ONE;
+        key.spots[i].intensity = RatioOD_RatioTo_Percent(light_param[i].intensity) * (Q16_ONE / 100.0f);
+        key.spots[i].color     = light_param[i].color;
+        key.spots[i].kernel    = light_param[i].kernel;
     }
 
     // Red dot mode
     if (red_dot_mode.red_dot)
     {
         // Get dot elapsed time
-        float dot_elapsed = (Luos_GetSystick() - TimeOD_TimeTo_ms(red_dot_mode.red_dot_date)) / RED_DOT_DURATION_MS;
+        uint32_t dot_elapsed = now_ms - red_dot_mode.red_dot_date;
         // Check if the red dot mode is over
-        if (dot_elapsed > 1.0)
+        if (dot_elapsed > RED_DOT_DURATION_MS)
         {
             red_dot_mode.red_dot = false;
         }
         else
         {
-            // Display the red dot depending on the current mode
-            switch (desk_ctx.mode)
+            // The red dot fade out during RED_DOT_DURATION_MS
+            // Keep 8 bits of ratio, we only need a new frame when the fade step change
+            key.selected  = selected_spot;
+            key.mode      = desk_fsm.state;
+            key.dot_ratio = (Q16_ONE - (q16_t)((dot_elapsed << 16) / RED_DOT_DURATION_MS)) & ~0xFF;
+        }
+    }
+
+    // Nothing changed since the last frame, there is nothing to render or send
+    if (render_valid && (memcmp(&key, &render_key, sizeof(render_key_t)) == 0))
+    {
+        return;
+    }
+    // Wait for the frame interval, changes keep accumulating until then
+    uint32_t elapsed_ms = now_ms - render_date;
+    if (render_valid && (elapsed_ms < frame_interval))
+    {
+        return;
+    }
+    render_date = now_ms;
+    render_key  = key;
+
+    // Compute the picture of each strip depending on the light parameters
+    uint8_t step   = 0;
+    bool new_frame = false;
+    bool bus_busy  = false;
+    for (uint8_t i = 0; i < strip_nb; i++)
+    {
+        strip_ctx_t *strip = &strips[i];
+        frame_ctx_t *frame = &strip->frame;
+        if (strip->led_nb == 0)
+        {
+            // The geometry of this strip is not known yet
+            continue;
+        }
+        LightTiming_StageStart(TIMING_RENDER);
+        LightCtrl_RenderStrip(strip, &key, render_pic);
+        LightTiming_StageEnd(TIMING_RENDER);
+
+        // The parameters changed but not enough to change the picture of this strip
+        uint8_t strip_step = LightCtrl_FrameStep(strip, render_pic);
+        if (render_valid && (strip_step == 0))
+        {
+            continue;
+        }
+        step     = (strip_step > step) ? strip_step : step;
+        bus_busy = bus_busy || frame->pending || frame->in_flight;
+        // A frame not sent yet is replaced, only the latest one matter
+        if (frame->pending)
+        {
+            frame->superseded++;
+        }
+        memcpy(frame->pixels, render_pic, strip->led_nb * sizeof(color_t));
+        frame->seq++;
+        frame->pending = true;
+        new_frame      = true;
+    }
+    render_valid = true;
+    if (new_frame)
+    {
+        LightCtrl_AdaptFrameRate(step, elapsed_ms, bus_busy);
+        LightCtrl_SendFrame();
+    }
+}
+
+/******************************************************************************
+ * @brief Place a led strip in the scene
+ *
+ * @param strip: strip to place
+ * @param led_nb: number of led of the strip
+ * @param length_m: length of the strip
+ * @param first_angle: angular position of the strip start in degrees
+ * @param angle: angle covered by the strip in degrees
+ * @return None
+ ******************************************************************************/
+static void LightCtrl_PlaceStrip(strip_ctx_t *strip, uint16_t led_nb, float length_m, float first_angle, float angle)
+{
+    // Keep the geometry in fixed point, it is only converted once
+    // A strip too long is only driven up to LED_STRIP_MAX_LED, its leds keep their place
+    strip->led_nb      = (led_nb > LED_STRIP_MAX_LED) ? LED_STRIP_MAX_LED : led_nb;
+    strip->first_angle = first_angle * Q16_ONE;
+    strip->led_per_deg = (angle > 0.0f) ? led_nb * Q16_ONE / angle : 0;
+    strip->led_per_m   = (length_m > 0.0f) ? led_nb * Q16_ONE / length_m : 0;
+}
+
+/******************************************************************************
+ * @brief Share the frame and weight buffers between the led strips
+ *
+ * @param None
+ * @return None
+ ******************************************************************************/
+static void LightCtrl_AllocateStrips(void)
+{
+    // Strips are served in detection order, the ones not fitting in the pool are shortened
+    uint16_t led_index = 0;
+    for (uint8_t i = 0; i < strip_nb; i++)
+    {
+        strip_ctx_t *strip = &strips[i];
+        if (strip->led_nb > LED_POOL_NB - led_index)
+        {
+            strip->led_nb = LED_POOL_NB - led_index;
+        }
+        strip->frame.pixels      = &pixel_pool[led_index];
+        strip->frame.sent_pixels = &pixel_pool[LED_POOL_NB + led_index];
+        for (uint8_t j = 0; j < LIGHT_SPOT_NB; j++)
+        {
+            strip->profiles[j].weight = &weight_pool[j * LED_POOL_NB + led_index];
+            strip->profiles[j].valid  = false;
+        }
+        led_index += strip->led_nb;
+        // The content of the buffers moved, send the next frame entirely
+        strip->frame.sent_valid = false;
+    }
+}
+
+/******************************************************************************
+ * @brief Ask their geometry to the led strips that didn't send it yet
+ *
+ * @param None
+ * @return None
+ ******************************************************************************/
+static void LightCtrl_AskGeometry(void)
+{
+    msg_t send_msg;
+    send_msg.header.target_mode = SERVICEID;
+    send_msg.header.cmd         = STRIP_GEOMETRY;
+    send_msg.header.size        = 0;
+    for (uint8_t i = 0; i < strip_nb; i++)
+    {
+        if (strips[i].led_nb == 0)
+        {
+            send_msg.header.target = strips[i].id;
+            LightTx_Push(&send_msg, TX_PRIORITY_CONFIG);
+        }
+    }
+    geometry_date = now_ms;
+}
+
+/******************************************************************************
+ * @brief Render the slice of the scene seen by a led strip
+ *
+ * @param strip: led strip to render
+ * @param key: light parameters to render
+ * @param pic: picture to fill with the strip leds
+ * @return None
+ ******************************************************************************/
+static void LightCtrl_RenderStrip(strip_ctx_t *strip, const render_key_t *key, color_t *pic)
+{
+    // Convert the spots into the strip leds
+    render_spot_t spots[LIGHT_SPOT_NB];
+    for (uint8_t i = 0; i < LIGHT_SPOT_NB; i++)
+    {
+        spots[i].center    = ((int64_t)(key->spots[i].angle - strip->first_angle) * strip->led_per_deg) >> 16;
+        spots[i].radius    = ((int64_t)key->spots[i].radius * strip->led_per_m) >> 16;
+        spots[i].intensity = key->spots[i].intensity;
+        spots[i].color     = key->spots[i].color;
+        spots[i].kernel    = key->spots[i].kernel;
+    }
+    LightRender_Spots(pic, strip->led_nb, spots, strip->profiles, LIGHT_SPOT_NB);
+
+    // Put the red dot indicators over the spots
+    render_layer_t overlays[OVERLAY_MAX_NB];
+    uint8_t overlay_nb = LightCtrl_RedDotLayers(strip, key, spots, overlays, OVERLAY_MAX_NB);
+    LightRender_Composite(pic, strip->led_nb, overlays, overlay_nb);
+}
+
+/******************************************************************************
+ * @brief Measure how much a picture changed from the last rendered one
+ *
+ * @param strip: led strip of the picture
+ * @param pic: new picture
+ * @return biggest color channel difference
+ ******************************************************************************/
+static uint8_t LightCtrl_FrameStep(const strip_ctx_t *strip, const color_t *pic)
+{
+    uint8_t step = 0;
+    for (int led = 0; led < strip->led_nb; led++)
+    {
+        const color_t *prev = &strip->frame.pixels[led];
+        uint8_t r           = (pic[led].r > prev->r) ? pic[led].r - prev->r : prev->r - pic[led].r;
+        uint8_t g           = (pic[led].g > prev->g) ? pic[led].g - prev->g : prev->g - pic[led].g;
+        uint8_t b           = (pic[led].b > prev->b) ? pic[led].b - prev->b : prev->b - pic[led].b;
+        step                = (r > step) ? r : step;
+        step                = (g > step) ? g : step;
+        step                = (b > step) ? b : step;
+    }
+    return step;
+}
+
+/******************************************************************************
+ * @brief Choose the interval until the next frame
+ *
+ * @param step: biggest color change of the new frame
+ * @param elapsed_ms: time since the previous frame
+ * @param bus_busy: a led strip have not displayed its previous frame yet
+ * @return None
+ ******************************************************************************/
+static void LightCtrl_AdaptFrameRate(uint8_t step, uint32_t elapsed_ms, bool bus_busy)
+{
+    // A light starting to move after a while is considered as moving since the longest interval
+    if (elapsed_ms > FRAME_MAX_INTERVAL_MS)
+    {
+        elapsed_ms = FRAME_MAX_INTERVAL_MS;
+    }
+    // Render often enough for each frame to change by about FRAME_TARGET_STEP at the current speed
+    uint32_t interval = (step > 0) ? (FRAME_TARGET_STEP * elapsed_ms) / step : FRAME_MAX_INTERVAL_MS;
+    // The bus can't follow this rate
+    if (bus_busy)
+    {
+        uint32_t backoff = frame_interval * 2;
+        interval         = (backoff > interval) ? backoff : interval;
+    }
+    if (interval < FRAMERATE_MS)
+    {
+        interval = FRAMERATE_MS;
+    }
+    if (interval > FRAME_MAX_INTERVAL_MS)
+    {
+        interval = FRAME_MAX_INTERVAL_MS;
+    }
+    frame_interval = interval;
+}
+
+/******************************************************************************
+ * @brief Build the red dot indicator layers of the current mode on a led strip
+ *
+ * @param strip: led strip to display the red dot on
+ * @param key: inputs of the frame to render
+ * @param spots: spots placed on this strip
+ * @param layers: table of layers to fill
+ * @param layer_max: number of layers of the table, the indicators not fitting in it are not displayed
+ * @return number of layers
+ ******************************************************************************/
+static uint8_t LightCtrl_RedDotLayers(const strip_ctx_t *strip, const render_key_t *key, const render_spot_t *spots, render_layer_t *layers, uint8_t layer_max)
+{
+    const color_t red         = {.r = 255, .g = 0, .b = 0};
+    const render_spot_t *spot = &spots[key->selected];
+    uint8_t layer_nb          = 0;
+    if (key->dot_ratio <= 0)
+    {
+        return 0;
+    }
+    // Display the red dot depending on the current mode, it fade out with dot_ratio
+    switch (key->mode)
+    {
+        case ANGLE_MODE:
+            // Overlap the center of the light to be red
+            layer_nb += LightCtrl_DotLayers(&layers[layer_nb], layer_max - layer_nb, strip, spot->center, red, key->dot_ratio);
+            break;
+        case INTENSITY_MODE:
+            // Overlap the first led of the scene to be white
+            if (strip == &strips[0])
+            {
+                layer_nb += LightCtrl_DotLayers(&layers[layer_nb], layer_max - layer_nb, strip, 0, (color_t){.r = 255, .g = 255, .b = 255}, key->dot_ratio);
+            }
+            break;
+        case RADIUS_MODE:
+            // Overlap the 2 external edges of the light to be red
+            layer_nb += LightCtrl_DotLayers(&layers[layer_nb], layer_max - layer_nb, strip, spot->center - spot->radius, red, key->dot_ratio);
+            layer_nb += LightCtrl_DotLayers(&layers[layer_nb], layer_max - layer_nb, strip, spot->center + spot->radius, red, key->dot_ratio);
+            break;
+        case COLOR_MODE:
+            // Put the 2 first led of the scene into the lowest and highest temperature we manage (between 1500K to 5500K)
+            if (strip == &strips[0])
+            {
+                layer_nb += LightCtrl_DotLayers(&layers[layer_nb], layer_max - layer_nb, strip, 0, (color_t){.r = 255, .g = 109, .b = 0}, key->dot_ratio);
+                layer_nb += LightCtrl_DotLayers(&layers[layer_nb], layer_max - layer_nb, strip, Q16_ONE, (color_t){.r = 255, .g = 236, .b = 224}, key->dot_ratio);
+            }
+            break;
+        default:
+            break;
+    }
+    return layer_nb;
+}
+
+/******************************************************************************
+ * @brief Build the layers of a dot placed at subpixel precision
+ *
+ * @param layers: table of layers to fill
+ * @param layer_max: number of layers of the table, the dot is not displayed if it has less than 2
+ * @param strip: led strip to display the dot on
+ * @param position: position of the dot in led of the strip, clamped to the scene
+ * @param color: color of the dot
+ * @param opacity: opacity of the dot
+ * @return number of layers
+ ******************************************************************************/
+static uint8_t LightCtrl_DotLayers(render_layer_t *layers, uint8_t layer_max, const strip_ctx_t *strip, q16_t position, color_t color, q16_t opacity)
+{
+    if (layer_max < 2)
+    {
+        return 0;
+    }
+    // A dot out of the scene is displayed at its end, a dot on another strip is clipped
+    if ((position < 0) && (strip == &strips[0]))
+    {
+        position = 0;
+    }
+    if ((position > ((strip->led_nb - 1) << 16)) && (strip == &strips[strip_nb - 1]))
+    {
+        position = (strip->led_nb - 1) << 16;
+    }
+    // The dot is shared between the 2 leds around its position depending on their distance to it
+    q16_t fraction = position & (Q16_ONE - 1);
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        layers[i].first_led = (position >> 16) + i;
+        layers[i].led_nb    = 1;
+        layers[i].blend     = RENDER_BLEND_FADE;
+        layers[i].color     = color;
+    }
+    layers[0].opacity = ((int64_t)opacity * (Q16_ONE - fraction)) >> 16;
+    layers[1].opacity = ((int64_t)opacity * fraction) >> 16;
+    return 2;
+}
+
+/******************************************************************************
+ * @brief Send the pending frames of the led strips ready for it
+ *
+ * @param None
+ * @return None
+ ******************************************************************************/
+static void LightCtrl_SendFrame(void)
+{
+    bool pending = false;
+    for (uint8_t i = 0; i < strip_nb; i++)
+    {
+        frame_ctx_t *frame = &strips[i].frame;
+        if (frame->pending && !frame->staged)
+        {
+            if (frame->in_flight && (now_ms - frame->sent_date < FRAME_ACK_TIMEOUT_MS))
             {
-                case ANGLE_MODE:
-                    // Overlap the center led to be red and fade it depending on dot_elapsed
-                    pic[(uint8_t)center_led].r = (255 * (1.0 - dot_elapsed)) + pic[(uint8_t)center_led].r * dot_elapsed;
-                    pic[(uint8_t)center_led].g = pic[(uint8_t)center_led].g * dot_elapsed;
-                    pic[(uint8_t)center_led].b = pic[(uint8_t)center_led].b * dot_elapsed;
-                    break;
-                case INTENSITY_MODE:
-                    // Overlap the first led to be white and fade it depending on dot_elapsed
-                    pic[0].r = (255 * (1.0 - dot_elapsed)) + pic[0].r * dot_elapsed;
-                    pic[0].g = (255 * (1.0 - dot_elapsed)) + pic[0].g * dot_elapsed;
-                    pic[0].b = (255 * (1.0 - dot_elapsed)) + pic[0].b * dot_elapsed;
-                    break;
-                case RADIUS_MODE:
-                    // Overlap the 2 external leds to be red and fade it depending on dot_elapsed
-                    first_led = center_led - radius_led;
-                    if (first_led < 0)
-                    {
-                        first_led = 0;
-                    }
-                    second_led = center_led + radius_led;
-                    if (second_led >= LED_STRIP_NB_LED)
-                    {
-                        second_led = LED_STRIP_NB_LED - 1;
-                    }
-                    pic[first_led].r = (255 * (1.0 - dot_elapsed)) + pic[first_led].r * dot_elapsed;
-                    pic[first_led].g = pic[first_led].g * dot_elapsed;
-                    pic[first_led].b = pic[first_led].b * dot_elapsed;
-
-                    pic[second_led].r = (255 * (1.0 - dot_elapsed)) + pic[second_led].r * dot_elapsed;
-                    pic[second_led].g = pic[second_led].g * dot_elapsed;
-                    pic[second_led].b = pic[second_led].b * dot_elapsed;
-                    break;
-                case COLOR_MODE:
-                    // Put the 2 first led into the lowest and highest temperature we manage (between 1500K to 5500K) and fade it depending on dot_elapsed
-                    pic[0].r = (255 * (1.0 - dot_elapsed)) + pic[0].r * dot_elapsed;
-                    pic[0].g = (109 * (1.0 - dot_elapsed)) + pic[0].g * dot_elapsed;
-                    pic[0].b = (0 * (1.0 - dot_elapsed)) + pic[0].b * dot_elapsed;
-                    pic[1].r = (255 * (1.0 - dot_elapsed)) + pic[0].r * dot_elapsed;
-                    pic[1].g = (236 * (1.0 - dot_elapsed)) + pic[0].g * dot_elapsed;
-                    pic[1].b = (224 * (1.0 - dot_elapsed)) + pic[0].b * dot_elapsed;
-                    break;
-                default:
-                    break;
+                // The led strips display their frames together, wait until all of them can take a new one
+                return;
             }
+            pending = true;
+        }
+    }
+    if (!pending || !LightTx_IsEmpty())
+    {
+        // Queued messages go first, frames can't delay the configuration of the other services
+        return;
+    }
+    LightTiming_StageStart(TIMING_SEND);
+    bool staged = false;
+    bool missed = false;
+    for (uint8_t i = 0; i < strip_nb; i++)
+    {
+        frame_ctx_t *frame = &strips[i].frame;
+        if (!frame->staged)
+        {
+            frame->staged = LightCtrl_SendStripFrame(&strips[i]);
+            missed        = missed || frame->pending;
         }
+        staged = staged || frame->staged;
+    }
+    if (staged && !missed)
+    {
+        // Every led strip got its frame, ask all of them to display it at the same time
+        msg_t msg;
+        msg.header.target      = BROADCAST_VAL;
+        msg.header.target_mode = BROADCAST;
+        msg.header.cmd         = FRAME_COMMIT;
+        msg.header.size        = 0;
+        LightTx_Push(&msg, TX_PRIORITY_FRAME);
+        for (uint8_t i = 0; i < strip_nb; i++)
+        {
+            strips[i].frame.staged = false;
+        }
+    }
+    LightTiming_StageEnd(TIMING_SEND);
+}
+
+/******************************************************************************
+ * @brief Send the pending frame of a led strip if it displayed the previous one
+ *
+ * @param strip: led strip to send the frame to
+ * @return true if a frame have been sent
+ ******************************************************************************/
+static bool LightCtrl_SendStripFrame(strip_ctx_t *strip)
+{
+    frame_ctx_t *frame = &strip->frame;
+    if (!frame->pending)
+    {
+        return false;
+    }
+    if (frame->in_flight && (now_ms - frame->sent_date < FRAME_ACK_TIMEOUT_MS))
+    {
+        // Wait for the led strip to acknowledge the previous frame
+        return false;
+    }
+    if (frame->in_flight)
+    {
+        // The previous frame have not been acknowledged, we don't know what the led strip display
+        frame->sent_valid = false;
+    }
+    frame->in_flight = false;
+    uint16_t size    = LightCtrl_BuildFrame(strip);
+    if (size == 0)
+    {
+        // The led strip already display this picture
+        frame->pending = false;
+        return false;
     }
 
-    // Send the picture to the led strip
+    // Send the changed parts of the picture to the led strip
     msg_t msg;
-    msg.header.target      = led_strip->id;
-    msg.header.target_mode = IDACK;
-    msg.header.cmd         = COLOR;
-    Luos_SendData(light_service, &msg, pic, sizeof(pic));
+    msg.header.target      = strip->id;
+    msg.header.target_mode = SERVICEID;
+    msg.header.cmd         = COLOR_FRAME;
+    if (size <= MAX_DATA_MSG_SIZE)
+    {
+        msg.header.size = size;
+        memcpy(msg.data, frame_tx, size);
+        if (Luos_SendMsg(light_service, &msg) != SUCCEED)
+        {
+            // Luos buffers are full, keep the frame pending for the next loop
+            return false;
+        }
+    }
+    else
+    {
+        // Luos_SendData waits for room before each chunk, only start it once the previous messages are gone
+        if (Luos_TxComplete() != SUCCEED)
+        {
+            return false;
+        }
+        Luos_SendData(light_service, &msg, frame_tx, size);
+    }
+    frame->pending = false;
+
+    memcpy(frame->sent_pixels, frame->pixels, strip->led_nb * sizeof(color_t));
+    frame->sent_valid = true;
+    frame->sent_seq   = frame->seq;
+    frame->in_flight  = true;
+    frame->sent_date  = now_ms;
+    return true;
+}
+
+/******************************************************************************
+ * @brief Build the COLOR_FRAME with the spans changed since the last frame sent
+ *
+ * @param strip: led strip to build the frame of
+ * @return size of the frame, 0 if nothing changed
+ ******************************************************************************/
+static uint16_t LightCtrl_BuildFrame(strip_ctx_t *strip)
+{
+    frame_ctx_t *frame    = &strip->frame;
+    frame_header_t header = {.seq = frame->seq, .span_nb = 0};
+    frame_span_t span;
+    uint16_t index = sizeof(frame_header_t);
+    int led        = 0;
+
+    while (led < strip->led_nb)
+    {
+        // Look for the next changed led
+        if (frame->sent_valid && (memcmp(&frame->pixels[led], &frame->sent_pixels[led], sizeof(color_t)) == 0))
+        {
+            led++;
+            continue;
+        }
+        // Extend the span up to the last changed led before a large enough unchanged gap
+        // The last span available goes up to the last changed led of the strip
+        int first = led;
+        int last  = led;
+        for (led++; led < strip->led_nb; led++)
+        {
+            if (!frame->sent_valid || (memcmp(&frame->pixels[led], &frame->sent_pixels[led], sizeof(color_t)) != 0))
+            {
+                last = led;
+            }
+            else if ((led - last > FRAME_SPAN_GAP) && (header.span_nb < FRAME_MAX_SPAN - 1))
+            {
+                break;
+            }
+        }
+        span.first_led = first;
+        span.led_nb    = last - first + 1;
+        led            = last + 1;
+        memcpy(&frame_tx[index], &span, sizeof(frame_span_t));
+        index += sizeof(frame_span_t);
+        memcpy(&frame_tx[index], &frame->pixels[span.first_led], span.led_nb * sizeof(color_t));
+        index += span.led_nb * sizeof(color_t);
+        header.span_nb++;
+    }
+    if (header.span_nb == 0)
+    {
+        return 0;
+    }
+    memcpy(frame_tx, &header, sizeof(frame_header_t));
+    return index;
 }
 
 /******************************************************************************
- * @brief Switch the light mode
+ * @brief Display the red dot of the current mode from now
  *
  * @param None
  * @return None
  ******************************************************************************/
-static void LightCtrl_modeSwitch(void)
+static void LightCtrl_ShowRedDot(void)
 {
-    switch (desk_ctx.mode)
+    red_dot_mode.red_dot      = true;
+    red_dot_mode.red_dot_date = now_ms;
+}
+
+/******************************************************************************
+ * @brief Start an animation on a spot
+ *
+ * @param spot: spot to animate
+ * @param animation: animation to play
+ * @return None
+ ******************************************************************************/
+static void LightCtrl_PlayAnimation(uint8_t spot, light_animation_t animation)
+{
+    // The scene is not the recalled preset anymore
+    recall_active = false;
+    LightTimeline_Stop(spot);
+    switch (animation)
     {
-        case STOP_MODE:
-            // Get back the light parameters
-            light_param = light_param_bak;
-            // Set the light intensity to 0 to get a smooth start.
-            light_param.intensity = RatioOD_RatioFrom_Percent(0.0);
-            desk_ctx.mode         = INTENSITY_MODE;
-            desk_ctx.desk_loop    = LightCtrl_intensityFiltering;
+        case ANIMATION_SUNRISE:
+            LightTimeline_Play(spot, TIMELINE_INTENSITY, sunrise_intensity, sizeof(sunrise_intensity) / sizeof(timeline_key_t), false, now_ms);
+            LightTimeline_Play(spot, TIMELINE_KELVIN, sunrise_kelvin, sizeof(sunrise_kelvin) / sizeof(timeline_key_t), false, now_ms);
+            LightTimeline_Play(spot, TIMELINE_RADIUS, sunrise_radius, sizeof(sunrise_radius) / sizeof(timeline_key_t), false, now_ms);
             break;
-        case START_MODE:
-            desk_ctx.mode      = INTENSITY_MODE;
-            desk_ctx.desk_loop = LightCtrl_intensityFiltering;
+        case ANIMATION_BREATHING:
+            LightTimeline_Play(spot, TIMELINE_INTENSITY, breathing_intensity, sizeof(breathing_intensity) / sizeof(timeline_key_t), true, now_ms);
             break;
-        case INTENSITY_MODE:
-            desk_ctx.mode      = RADIUS_MODE;
-            desk_ctx.desk_loop = LightCtrl_radiusFiltering;
+        case ANIMATION_STOP:
+        default:
             break;
-        case RADIUS_MODE:
-            desk_ctx.mode      = COLOR_MODE;
-            desk_ctx.desk_loop = LightCtrl_doNothing;
+    }
+}
+
+/******************************************************************************
+ * @brief Set a light parameter to the value of its timeline track
+ *
+ * @param spot: spot animated
+ * @param channel: parameter animated
+ * @param value: value of the parameter in the timeline unit
+ * @return None
+ ******************************************************************************/
+static void LightCtrl_ApplyTimeline(uint8_t spot, timeline_channel_t channel, int32_t value)
+{
+    // Remote commands and animations may ask for anything, the color conversion only works in the desk range
+    value = LightCtrl_ClampParam(channel, value);
+    switch (channel)
+    {
+        case TIMELINE_ANGLE:
+            light_param[spot].angle = AngularOD_PositionFrom_deg(value / 100.0f);
             break;
-        case COLOR_MODE:
-            desk_ctx.mode      = ANGLE_MODE;
-            desk_ctx.desk_loop = LightCtrl_angleFiltering;
+        case TIMELINE_RADIUS:
+            light_param[spot].radius = LinearOD_PositionFrom_m(value / 1000.0f);
             break;
-        case ANGLE_MODE:
-            desk_ctx.mode      = INTENSITY_MODE;
-            desk_ctx.desk_loop = LightCtrl_intensityFiltering;
+        case TIMELINE_INTENSITY:
+            light_param[spot].intensity = RatioOD_RatioFrom_Percent(value / 100.0f);
+            break;
+        case TIMELINE_KELVIN:
+            light_param[spot].color = IlluminanceOD_ColorFrom_Kelvin((float)value);
             break;
         default:
             break;
@@ -446,19 +1312,399 @@ static void LightCtrl_modeSwitch(void)
 }
 
 /******************************************************************************
- * @brief Do nothing
+ * @brief Keep a light parameter in the range the potentiometer gives it
+ *
+ * @param channel: parameter to clamp
+ * @param value: value of the parameter in the timeline unit
+ * @return value clamped to the range of the parameter
+ ******************************************************************************/
+static int32_t LightCtrl_ClampParam(timeline_channel_t channel, int32_t value)
+{
+    static const int32_t param_min[TIMELINE_CHANNEL_NB] = {
+        [TIMELINE_ANGLE]     = 0,
+        [TIMELINE_RADIUS]    = 0,
+        [TIMELINE_INTENSITY] = 0,
+        [TIMELINE_KELVIN]    = LIGHT_KELVIN_MIN,
+    };
+    static const int32_t param_max[TIMELINE_CHANNEL_NB] = {
+        [TIMELINE_ANGLE]     = 18000,
+        [TIMELINE_RADIUS]    = (int32_t)(LIGHT_RADIUS_MAX_M * 1000),
+        [TIMELINE_INTENSITY] = 10000,
+        [TIMELINE_KELVIN]    = LIGHT_KELVIN_MAX,
+    };
+    if (channel >= TIMELINE_CHANNEL_NB)
+    {
+        return value;
+    }
+    if (value < param_min[channel])
+    {
+        return param_min[channel];
+    }
+    if (value > param_max[channel])
+    {
+        return param_max[channel];
+    }
+    return value;
+}
+
+/******************************************************************************
+ * @brief Set a light parameter at once or with a transition
+ *
+ * @param set: parameter to set and how to reach it
+ * @return false if the command is not valid
+ ******************************************************************************/
+static bool LightCtrl_SetParam(const light_set_t *set)
+{
+    if ((set->spot >= LIGHT_SPOT_NB) || (set->channel >= LIGHT_CHANNEL_NB) || (set->ease > TIMELINE_EASE_IN_OUT))
+    {
+        return false;
+    }
+    // The scene is not the recalled preset anymore
+    recall_active = false;
+    // light_channel_t and timeline_channel_t share the same order and units.
+    // Clamp the target to let the transition last its whole duration.
+    timeline_channel_t channel = (timeline_channel_t)set->channel;
+    LightCtrl_MoveParam(set->spot, channel, LightCtrl_ClampParam(channel, set->value), set->duration_ms, set->ease);
+    return true;
+}
+
+/******************************************************************************
+ * @brief Move a light parameter to a value at once or with a transition
+ *
+ * @param spot: spot of the parameter
+ * @param channel: parameter to move
+ * @param value: value to reach in the timeline unit
+ * @param duration_ms: duration of the transition, 0 to apply the value on the next frame
+ * @param ease: timeline_ease_t curve of the transition
+ * @return None
+ ******************************************************************************/
+static void LightCtrl_MoveParam(uint8_t spot, timeline_channel_t channel, int32_t value, uint16_t duration_ms, uint8_t ease)
+{
+    timeline_key_t *keys = param_keys[spot][channel];
+    uint8_t key_nb       = 1;
+    if (duration_ms > 0)
+    {
+        // Start the track from the displayed value
+        keys[0].date_ms = 0;
+        keys[0].value   = LightCtrl_ParamValue(&light_param[spot], channel);
+        keys[0].ease    = TIMELINE_EASE_LINEAR;
+        key_nb          = 2;
+    }
+    keys[key_nb - 1].date_ms = duration_ms;
+    keys[key_nb - 1].value   = value;
+    keys[key_nb - 1].ease    = ease;
+    // The track replaces the one animating this parameter, a single key is applied on the next frame and removed
+    if (!LightTimeline_Play(spot, channel, keys, key_nb, false, now_ms))
+    {
+        // Every track is playing, apply the value at once
+        LightCtrl_ApplyTimeline(spot, channel, value);
+    }
+}
+
+/******************************************************************************
+ * @brief Get the value of a light parameter in the timeline unit
+ *
+ * @param param: parameters of a spot
+ * @param channel: parameter to get
+ * @return value of the parameter
+ ******************************************************************************/
+static int32_t LightCtrl_ParamValue(const light_param_t *param, timeline_channel_t channel)
+{
+    switch (channel)
+    {
+        case TIMELINE_ANGLE:
+            return (int32_t)(AngularOD_PositionTo_deg(param->angle) * 100.0f + 0.5f);
+        case TIMELINE_RADIUS:
+            return (int32_t)(LinearOD_PositionTo_m(param->radius) * 1000.0f + 0.5f);
+        case TIMELINE_INTENSITY:
+            return (int32_t)(RatioOD_RatioTo_Percent(param->intensity) * 100.0f + 0.5f);
+        case TIMELINE_KELVIN:
+            return (int32_t)(IlluminanceOD_KelvinFrom_Color(param->color) + 0.5f);
+        default:
+            return 0;
+    }
+}
+
+/******************************************************************************
+ * @brief Store the current scene in a preset
+ *
+ * @param index: preset to store the scene in
+ * @return false if the scene can't be stored
+ ******************************************************************************/
+static bool LightCtrl_SavePreset(uint8_t index)
+{
+    return LightPreset_Save(index, LightCtrl_Scene(), sizeof(light_param));
+}
+
+/******************************************************************************
+ * @brief Go to the scene stored in a preset
+ *
+ * @param index: preset to recall
+ * @return false if there is no scene stored in this preset
+ ******************************************************************************/
+static bool LightCtrl_RecallPreset(uint8_t index)
+{
+    light_param_t scene[LIGHT_SPOT_NB];
+    if (!LightPreset_Load(index, scene, sizeof(scene)))
+    {
+        return false;
+    }
+    current_preset = index;
+    for (uint8_t i = 0; i < LIGHT_SPOT_NB; i++)
+    {
+        // The preset replaces the whole scene, the light smoothly goes from the displayed scene to it
+        LightTimeline_Stop(i);
+        for (uint8_t channel = 0; channel < TIMELINE_CHANNEL_NB; channel++)
+        {
+            if ((channel == TIMELINE_KELVIN) && (memcmp(&light_param[i].color, &scene[i].color, sizeof(color_t)) == 0))
+            {
+                // Keep the exact color, the Kelvin conversion is not lossless
+                continue;
+            }
+            LightCtrl_MoveParam(i, channel, LightCtrl_ParamValue(&scene[i], channel), PRESET_TRANSITION_MS, TIMELINE_EASE_IN_OUT);
+        }
+        light_param[i].kernel = scene[i].kernel;
+    }
+    memcpy(light_param_bak, scene, sizeof(light_param));
+    recall_active = true;
+    recall_date   = now_ms;
+    raw_angle     = scene[selected_spot].angle;
+    raw_radius    = scene[selected_spot].radius;
+    raw_intensity = scene[selected_spot].intensity;
+    return true;
+}
+
+/******************************************************************************
+ * @brief Go to the next stored preset
+ *
+ * @param None
+ * @return false if there is no preset stored
+ ******************************************************************************/
+static bool LightCtrl_RecallNextPreset(void)
+{
+    for (uint8_t i = 1; i <= PRESET_NB; i++)
+    {
+        if (LightCtrl_RecallPreset((current_preset + i) % PRESET_NB))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/******************************************************************************
+ * @brief Check if the light is still going to a recalled preset
+ *
+ * @param None
+ * @return true until the end of the recall transition
+ ******************************************************************************/
+static bool LightCtrl_Recalling(void)
+{
+    if (recall_active && (now_ms - recall_date >= PRESET_TRANSITION_MS))
+    {
+        recall_active = false;
+    }
+    return recall_active;
+}
+
+/******************************************************************************
+ * @brief Get the scene the light is going to
+ *
+ * @param None
+ * @return scene of LIGHT_SPOT_NB spots
+ ******************************************************************************/
+static const light_param_t *LightCtrl_Scene(void)
+{
+    // The displayed scene is an intermediate one during a recall or a stop, the target is kept in light_param_bak
+    if (LightCtrl_Recalling() || (desk_fsm.state == STOP_MODE))
+    {
+        return light_param_bak;
+    }
+    return light_param;
+}
+
+/******************************************************************************
+ * @brief Start from the last logged light state
  *
  * @param None
  * @return None
  ******************************************************************************/
-static void LightCtrl_doNothing(void)
+static void LightCtrl_RestoreState(void)
 {
-    // Go back to the start mode if noting moves.
-    if (red_dot_mode.red_dot)
+    light_state_t state;
+    LUOS_ASSERT(sizeof(light_state_t) <= LOG_DATA_SIZE);
+    if (!LightLog_Restore(&state, sizeof(light_state_t)) || (state.selected_spot >= LIGHT_SPOT_NB))
+    {
+        // Keep the default scene
+        return;
+    }
+    memcpy(light_param, state.param, sizeof(light_param));
+    memcpy(light_param_bak, state.param, sizeof(light_param));
+    selected_spot = state.selected_spot;
+    raw_angle     = light_param[selected_spot].angle;
+    raw_radius    = light_param[selected_spot].radius;
+    raw_intensity = light_param[selected_spot].intensity;
+    if (state.stopped)
+    {
+        // Stay off, the scene is back on the next push
+        for (uint8_t i = 0; i < LIGHT_SPOT_NB; i++)
+        {
+            light_param[i].intensity = RatioOD_RatioFrom_Percent(0.0);
+        }
+    }
+    else
+    {
+        // Light the scene back without waiting for the desk
+        LightFsm_Post(&desk_fsm, DESK_EVENT_RECALL);
+    }
+}
+
+/******************************************************************************
+ * @brief Give the light state to the log and let it write the flash
+ *
+ * @param None
+ * @return None
+ ******************************************************************************/
+static void LightCtrl_LogState(void)
+{
+    // Animated parameters never settle and would be restored as a fixed level, keep the state logged before the animation.
+    // The target of a recall is known, it is logged right away.
+    if (!LightTimeline_IsPlaying() || LightCtrl_Recalling())
+    {
+        light_state_t state;
+        // Clear the padding to compare states byte by byte
+        memset(&state, 0, sizeof(light_state_t));
+        memcpy(state.param, LightCtrl_Scene(), sizeof(light_param));
+        state.selected_spot = selected_spot;
+        state.stopped       = (desk_fsm.state == STOP_MODE);
+        LightLog_Write(&state, sizeof(light_state_t), now_ms);
+    }
+    // A flash erase stalls the CPU, it is only done while the light doesn't move
+    LightLog_Loop(now_ms, (now_ms - render_date > LIGHT_IDLE_MS));
+}
+
+/******************************************************************************
+ * @brief Turn the button states into desk events
+ *
+ * @param state: button state
+ * @return None
+ ******************************************************************************/
+static void LightCtrl_ButtonEvents(bool state)
+{
+    if (state != button_ctx.last_state)
+    {
+        if (state)
+        {
+            // Someone start pushing the button, start measuring time
+            button_ctx.push_date = now_ms;
+            button_ctx.pushed    = true;
+            // A push shortly following a short push is a double push if it is short too, never a single push
+            button_ctx.second_push     = button_ctx.release_pending && (now_ms - button_ctx.release_date <= BUTTON_DOUBLE_PUSH_MS);
+            button_ctx.release_pending = false;
+        }
+        else if (button_ctx.pushed && button_ctx.second_push)
+        {
+            // Second short push, the recall of the double push goes back to the start mode over the switch of the first push
+            LightFsm_Post(&desk_fsm, DESK_EVENT_DOUBLE_PUSH);
+            button_ctx.second_push = false;
+            button_ctx.pushed      = false;
+        }
+        else if (button_ctx.pushed)
+        {
+            // The button was released before the end of the BUTTON_STOP_PERIOS_MS, switch mode right away.
+            // A second push may still make it a double push.
+            LightFsm_Post(&desk_fsm, DESK_EVENT_PUSH);
+            button_ctx.release_pending = true;
+            button_ctx.release_date    = now_ms;
+            button_ctx.pushed          = false;
+        }
+        button_ctx.last_state = state;
+    }
+    if (button_ctx.pushed && (now_ms - button_ctx.push_date > BUTTON_STOP_PERIOS_MS))
+    {
+        // The button is still pushed after the BUTTON_STOP_PERIOS_MS, the release and any previous short push are ignored
+        LightFsm_Post(&desk_fsm, DESK_EVENT_LONG_PUSH);
+        button_ctx.pushed          = false;
+        button_ctx.second_push     = false;
+        button_ctx.release_pending = false;
+    }
+}
+
+/******************************************************************************
+ * @brief Light the scene back on from the stop mode
+ *
+ * @param None
+ * @return true
+ ******************************************************************************/
+static bool LightCtrl_StartLight(void)
+{
+    // Get back the light parameters
+    memcpy(light_param, light_param_bak, sizeof(light_param));
+    // Set the controlled spot intensity to 0 to get a smooth start.
+    light_param[selected_spot].intensity = RatioOD_RatioFrom_Percent(0.0);
+    LightCtrl_ShowRedDot();
+    return true;
+}
+
+/******************************************************************************
+ * @brief Stop the light, it fades out from the current scene
+ *
+ * @param None
+ * @return true
+ ******************************************************************************/
+static bool LightCtrl_StopLight(void)
+{
+    if (LightCtrl_Recalling())
+    {
+        // Stop on the recalled preset
+        memcpy(light_param, light_param_bak, sizeof(light_param));
+        recall_active = false;
+    }
+    for (uint8_t i = 0; i < LIGHT_SPOT_NB; i++)
     {
-        // Update the light
-        LightCtrl_UpdateLight();
+        LightTimeline_Stop(i);
     }
+    memcpy(light_param_bak, light_param, sizeof(light_param));
+    return true;
+}
+
+/******************************************************************************
+ * @brief Light the stopped scene back on for a remote command
+ *
+ * @param None
+ * @return true
+ ******************************************************************************/
+static bool LightCtrl_ResumeLight(void)
+{
+    // Get back the scene saved when stopping, the remote command plays over it
+    memcpy(light_param, light_param_bak, sizeof(light_param));
+    return true;
+}
+
+/******************************************************************************
+ * @brief Go to the next parameter controlled by the potentiometer
+ *
+ * @param None
+ * @return true
+ ******************************************************************************/
+static bool LightCtrl_NextMode(void)
+{
+    // The light may have moved since the last use of the filters, start them from it
+    LightCtrl_ResetFilters();
+    LightCtrl_ShowRedDot();
+    return true;
+}
+
+/******************************************************************************
+ * @brief Do nothing
+ *
+ * @param None
+ * @return None
+ ******************************************************************************/
+static void LightCtrl_doNothing(void)
+{
+    // Update the light, nothing is sent if the red dot and the parameters don't change
+    LightCtrl_UpdateLight();
 }
 
 /******************************************************************************
@@ -469,17 +1715,20 @@ static void LightCtrl_doNothing(void)
  ******************************************************************************/
 static void LightCtrl_fadeLight(void)
 {
-    if (RatioOD_RatioTo_Percent(light_param.intensity) >= 0.01)
+    for (uint8_t i = 0; i < LIGHT_SPOT_NB; i++)
     {
-        // Fade the light
-        light_param.intensity = RatioOD_RatioFrom_Percent(RatioOD_RatioTo_Percent(light_param.intensity) - 1.0f);
-        if (RatioOD_RatioTo_Percent(light_param.intensity) < 0.01)
+        if (RatioOD_RatioTo_Percent(light_param[i].intensity) >= 0.01)
         {
-            light_param.intensity = RatioOD_RatioFrom_Percent(0.0);
+            // Fade the light
+            light_param[i].intensity = RatioOD_RatioFrom_Percent(RatioOD_RatioTo_Percent(light_param[i].intensity) - 1.0f);
+            if (RatioOD_RatioTo_Percent(light_param[i].intensity) < 0.01)
+            {
+                light_param[i].intensity = RatioOD_RatioFrom_Percent(0.0);
+            }
         }
-        // Update the light
-        LightCtrl_UpdateLight();
     }
+    // Update the light, nothing is sent once the light is off
+    LightCtrl_UpdateLight();
 }
 
 /******************************************************************************
@@ -488,12 +1737,10 @@ static void LightCtrl_fadeLight(void)
  * @param None
  * @return None
  ******************************************************************************/
-void LightCtrl_angleFiltering(void)
+static void LightCtrl_angleFiltering(void)
 {
-    // Filtering variables
-    static filtering_ctx_t angular_filtering = {0.0, 0.0};
-
-    light_param.angle = AngularOD_PositionFrom_deg(LightCtrl_genericFiltering(&angular_filtering, AngularOD_PositionTo_deg(raw_angle)));
+    light_param[selected_spot].angle = AngularOD_PositionFrom_deg(LightCtrl_Filter(&angle_filter, AngularOD_PositionTo_deg(raw_angle), 180.0 / POT_COURSE_DEG, 180.0));
+    LightCtrl_UpdateLight();
 }
 
 /******************************************************************************
@@ -504,10 +1751,8 @@ void LightCtrl_angleFiltering(void)
  ******************************************************************************/
 static void LightCtrl_intensityFiltering(void)
 {
-    // Filtering variables
-    static filtering_ctx_t intensity_filtering = {0.0, 0.0};
-
-    light_param.intensity = RatioOD_RatioFrom_Percent(LightCtrl_genericFiltering(&intensity_filtering, RatioOD_RatioTo_Percent(raw_intensity)));
+    light_param[selected_spot].intensity = RatioOD_RatioFrom_Percent(LightCtrl_Filter(&intensity_filter, RatioOD_RatioTo_Percent(raw_intensity), 100.0 / POT_COURSE_DEG, 100.0));
+    LightCtrl_UpdateLight();
 }
 
 /******************************************************************************
@@ -518,56 +1763,65 @@ static void LightCtrl_intensityFiltering(void)
  ******************************************************************************/
 static void LightCtrl_radiusFiltering(void)
 {
-    // Filtering variables
-    static filtering_ctx_t radius_filtering = {0.0, 0.0};
-
-    light_param.radius = LinearOD_PositionFrom_cm(LightCtrl_genericFiltering(&radius_filtering, LinearOD_PositionTo_cm(raw_radius)));
+    light_param[selected_spot].radius = LinearOD_PositionFrom_cm(LightCtrl_Filter(&radius_filter, LinearOD_PositionTo_cm(raw_radius), LIGHT_RADIUS_MAX_M * 100.0 / POT_COURSE_DEG, LIGHT_RADIUS_MAX_M * 100.0));
+    LightCtrl_UpdateLight();
 }
 
 /******************************************************************************
- * @brief Generic filtering function
+ * @brief Filter a parameter and show the red dot while the light catches up with the potentiometer
  *
- * @param f_ctx: filtering context
- * @param raw_val: raw value to filter
+ * @param filter: filter of the parameter
+ * @param raw_val: raw value of the parameter
+ * @param scale: parameter unit for each potentiometer degree
+ * @param max_val: biggest value of the parameter
  * @return filtered value
  ******************************************************************************/
-float LightCtrl_genericFiltering(filtering_ctx_t *f_ctx, float raw_val)
+static float LightCtrl_Filter(filter_t *filter, float raw_val, float scale, float max_val)
 {
-    // Angular movement
-    const float filtering_strength = 0.03; // 0.04
-    const float inertia_strength   = 0.1;  // 0.03
-    const float max_speed          = 0.3;  // 0.3
-
-    // Compute the error between the light and the real hand position
-    float err = raw_val - f_ctx->prev_val;
-    // Now check if the value changed to enable the red dot mode
-    if (fabs(err) > 2.0)
+    // Move the target where the hand will be once the frame is displayed
+    float predicted = raw_val + scale * LightPredict_Offset(&pot_predict, now_ms, display_latency_ms) / (float)Q16_ONE;
+    predicted       = (predicted < 0.0f) ? 0.0f : ((predicted > max_val) ? max_val : predicted);
+    q16_t target    = (q16_t)(predicted * Q16_ONE);
+    q16_t value     = LightFilter_Update(filter, target, now_ms);
+    if ((target - value > FILTER_RED_DOT_GAP) || (value - target > FILTER_RED_DOT_GAP))
     {
-        red_dot_mode.red_dot      = true;
-        red_dot_mode.red_dot_date = TimeOD_TimeFrom_ms(Luos_GetSystick());
+        LightCtrl_ShowRedDot();
     }
-    // Compute inertial delta force (integral)
-    f_ctx->inertial_force += err;
-    // Inertia clamping
-    if (f_ctx->inertial_force < -max_speed)
-        f_ctx->inertial_force = -max_speed;
-    if (f_ctx->inertial_force > max_speed)
-        f_ctx->inertial_force = max_speed;
-
-    // Then filter the position to give an inertia effect
-    float result = f_ctx->prev_val + (filtering_strength * err) + (inertia_strength * f_ctx->inertial_force);
-
-    // Update the light
-    LightCtrl_UpdateLight();
+    return (float)value / Q16_ONE;
+}
 
-    // Go back to the start mode if noting moves.
-    if (!red_dot_mode.red_dot)
+/******************************************************************************
+ * @brief Give a potentiometer position to the speed estimation, dated when it has been measured
+ *
+ * @param msg: ANGULAR_POSITION message of the potentiometer
+ * @return None
+ ******************************************************************************/
+static void LightCtrl_PotSample(msg_t *msg)
+{
+    angular_position_t position;
+    uint32_t date_ms = Luos_GetSystick();
+    if (Luos_IsMsgTimstamped(msg))
     {
-
-        desk_ctx.mode      = START_MODE;
-        desk_ctx.desk_loop = LightCtrl_doNothing;
+        // The position is as old as the bus and the potentiometer loop made it
+        float age_ms = TimeOD_TimeTo_ms(Timestamp_now()) - TimeOD_TimeTo_ms(Luos_GetMsgTimestamp(msg));
+        if ((age_ms > 0.0f) && (age_ms < PREDICT_MAX_GAP_MS))
+        {
+            date_ms -= (uint32_t)age_ms;
+        }
     }
+    AngularOD_PositionFromMsg(&position, msg);
+    LightPredict_Sample(&pot_predict, (q16_t)(AngularOD_PositionTo_deg(position) * Q16_ONE), date_ms);
+}
 
-    f_ctx->prev_val = result;
-    return result;
-}
\ No newline at end of file
+/******************************************************************************
+ * @brief Start the filters from the parameters of the selected spot
+ *
+ * @param None
+ * @return None
+ ******************************************************************************/
+static void LightCtrl_ResetFilters(void)
+{
+    LightFilter_Reset(&angle_filter, (q16_t)(AngularOD_PositionTo_deg(light_param[selected_spot].angle) * Q16_ONE), now_ms);
+    LightFilter_Reset(&radius_filter, (q16_t)(LinearOD_PositionTo_cm(light_param[selected_spot].radius) * Q16_ONE), now_ms);
+    LightFilter_Reset(&intensity_filter, (q16_t)(RatioOD_RatioTo_Percent(light_param[selected_spot].intensity) * Q16_ONE), now_ms);
+}
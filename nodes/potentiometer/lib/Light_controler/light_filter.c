@@ -0,0 +1,192 @@
+/******************************************************************************
+ * @file light filter
+ * @brief fixed point filters smoothing the desk inputs
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#include "light_filter.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define FILTER_TWO_PI   411775 // 2π in Q16.16
+#define FILTER_EXP_C2   31457  // 0.48 in Q16.16
+#define FILTER_EXP_C3   15401  // 0.235 in Q16.16
+#define FILTER_MAX_Q16  0x7FFFFFFF
+#define FILTER_MIN_Q16  (-0x7FFFFFFF)
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+static q16_t LightFilter_Exponential(filter_t *filter, q16_t target, uint32_t dt_ms);
+static q16_t LightFilter_OneEuro(filter_t *filter, q16_t previous, q16_t target, uint32_t dt_ms);
+static q16_t LightFilter_Spring(filter_t *filter, q16_t target, uint32_t dt_ms);
+static q16_t LightFilter_Alpha(q16_t cutoff, uint32_t dt_ms);
+static q16_t LightFilter_Clamp(int64_t value);
+
+/******************************************************************************
+ * @brief init a filter, it starts on the first value
+ * @param filter: filter to init
+ * @param param: parameters of the filter, they have to stay available
+ * @return None
+ ******************************************************************************/
+void LightFilter_Init(filter_t *filter, const filter_param_t *param)
+{
+    memset(filter, 0, sizeof(filter_t));
+    filter->param = param;
+}
+
+/******************************************************************************
+ * @brief Restart a filter at rest on a value
+ * @param filter: filter to restart
+ * @param value: value the filter starts from
+ * @param date_ms: current systick
+ * @return None
+ ******************************************************************************/
+void LightFilter_Reset(filter_t *filter, q16_t value, uint32_t date_ms)
+{
+    filter->started = true;
+    filter->date_ms = date_ms;
+    filter->value   = value;
+    filter->target  = value;
+    filter->speed   = 0;
+}
+
+/******************************************************************************
+ * @brief Filter a new value
+ * @param filter: filter to update
+ * @param target: raw value
+ * @param date_ms: current systick
+ * @return filtered value
+ ******************************************************************************/
+q16_t LightFilter_Update(filter_t *filter, q16_t target, uint32_t date_ms)
+{
+    if (!filter->started)
+    {
+        LightFilter_Reset(filter, target, date_ms);
+        return target;
+    }
+    uint32_t dt_ms  = date_ms - filter->date_ms;
+    filter->date_ms = date_ms;
+    if (dt_ms == 0)
+    {
+        return filter->value;
+    }
+    if (dt_ms > FILTER_MAX_STEP_MS)
+    {
+        dt_ms = FILTER_MAX_STEP_MS;
+    }
+    q16_t previous = filter->target;
+    filter->target = target;
+    switch (filter->param->type)
+    {
+        case FILTER_ONE_EURO:
+            filter->value = LightFilter_OneEuro(filter, previous, target, dt_ms);
+            break;
+        case FILTER_SPRING:
+            filter->value = LightFilter_Spring(filter, target, dt_ms);
+            break;
+        case FILTER_EXPONENTIAL:
+        default:
+            filter->value = LightFilter_Exponential(filter, target, dt_ms);
+            break;
+    }
+    return filter->value;
+}
+
+/******************************************************************************
+ * @brief First order low pass filter
+ * @param filter: filter to update
+ * @param target: raw value
+ * @param dt_ms: time since the last update
+ * @return filtered value
+ ******************************************************************************/
+static q16_t LightFilter_Exponential(filter_t *filter, q16_t target, uint32_t dt_ms)
+{
+    // alpha = dt / (time + dt)
+    int64_t alpha = ((int64_t)dt_ms << 16) / (filter->param->time_ms + dt_ms);
+    return filter->value + (q16_t)(((int64_t)target - filter->value) * alpha >> 16);
+}
+
+/******************************************************************************
+ * @brief One euro filter, the cutoff frequency follows the filtered speed
+ * @param filter: filter to update
+ * @param previous: raw value of the previous update
+ * @param target: raw value
+ * @param dt_ms: time since the last update
+ * @return filtered value
+ ******************************************************************************/
+static q16_t LightFilter_OneEuro(filter_t *filter, q16_t previous, q16_t target, uint32_t dt_ms)
+{
+    const filter_param_t *param = filter->param;
+    // Speed of the raw value in unit/s, not the lag of the filtered one, filtered with a fixed cutoff
+    q16_t speed   = LightFilter_Clamp(((int64_t)target - previous) * 1000 / dt_ms);
+    q16_t alpha   = LightFilter_Alpha(param->d_cutoff, dt_ms);
+    filter->speed = LightFilter_Clamp(filter->speed + (((int64_t)speed - filter->speed) * alpha >> 16));
+    // The faster the value moves, the less it is delayed
+    int64_t abs_speed = (filter->speed < 0) ? -(int64_t)filter->speed : filter->speed;
+    q16_t cutoff      = LightFilter_Clamp(param->min_cutoff + ((abs_speed * param->beta) >> 16));
+    alpha             = LightFilter_Alpha(cutoff, dt_ms);
+    return filter->value + (q16_t)(((int64_t)target - filter->value) * alpha >> 16);
+}
+
+/******************************************************************************
+ * @brief Critically damped spring, exact for any step thanks to an exponential approximation
+ * @param filter: filter to update
+ * @param target: raw value
+ * @param dt_ms: time since the last update
+ * @return filtered value
+ ******************************************************************************/
+static q16_t LightFilter_Spring(filter_t *filter, q16_t target, uint32_t dt_ms)
+{
+    uint16_t time_ms = filter->param->time_ms;
+    if (time_ms == 0)
+    {
+        filter->speed = 0;
+        return target;
+    }
+    // x = ω × dt with ω = 2 / time, e = exp(-x) ≈ 1 / (1 + x + 0.48x² + 0.235x³)
+    int64_t x      = ((int64_t)(2 * dt_ms) << 16) / time_ms;
+    int64_t x2     = (x * x) >> 16;
+    int64_t x3     = (x2 * x) >> 16;
+    int64_t e      = ((int64_t)Q16_ONE << 16) / (Q16_ONE + x + ((x2 * FILTER_EXP_C2) >> 16) + ((x3 * FILTER_EXP_C3) >> 16));
+    int64_t change = (int64_t)filter->value - target;
+    int64_t temp   = (int64_t)filter->speed * dt_ms + ((x * change) >> 16);
+    filter->speed  = LightFilter_Clamp((((int64_t)filter->speed - 2 * temp / time_ms) * e) >> 16);
+    return LightFilter_Clamp(target + (((change + temp) * e) >> 16));
+}
+
+/******************************************************************************
+ * @brief Smoothing factor of a low pass filter
+ * @param cutoff: cutoff frequency in Hz
+ * @param dt_ms: time since the last update
+ * @return smoothing factor between 0 and Q16_ONE
+ ******************************************************************************/
+static q16_t LightFilter_Alpha(q16_t cutoff, uint32_t dt_ms)
+{
+    // alpha = 1 / (1 + tau / dt) with tau = 1 / (2π × cutoff), w = 2π × cutoff × dt in rad.ms/s
+    int64_t w = (((int64_t)cutoff * FILTER_TWO_PI) >> 16) * dt_ms;
+    return (q16_t)((w << 16) / (w + ((int64_t)1000 << 16)));
+}
+
+/******************************************************************************
+ * @brief Saturate a value in the Q16.16 range
+ * @param value: value to saturate
+ * @return saturated value
+ ******************************************************************************/
+static q16_t LightFilter_Clamp(int64_t value)
+{
+    if (value > FILTER_MAX_Q16)
+    {
+        return FILTER_MAX_Q16;
+    }
+    if (value < FILTER_MIN_Q16)
+    {
+        return FILTER_MIN_Q16;
+    }
+    return (q16_t)value;
+}
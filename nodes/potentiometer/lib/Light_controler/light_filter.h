@@ -0,0 +1,55 @@
+/******************************************************************************
+ * @file light filter
+ * @brief fixed point filters smoothing the desk inputs
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#ifndef LIGHT_FILTER_H
+#define LIGHT_FILTER_H
+
+#include "light_render.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define FILTER_MAX_STEP_MS 100 // longer steps are filtered as this one, the filter don't jump after a pause
+
+typedef enum
+{
+    FILTER_EXPONENTIAL, // first order low pass
+    FILTER_ONE_EURO,    // low pass with a cutoff rising with the speed, steady at rest and responsive when moving
+    FILTER_SPRING,      // critically damped spring, reaches the target smoothly without overshoot
+    FILTER_TYPE_NB
+} filter_type_t;
+
+typedef struct
+{
+    uint8_t type;     // filter_type_t
+    uint16_t time_ms; // exponential time constant or spring smooth time, 0 follows the target
+    q16_t min_cutoff; // one euro cutoff frequency at rest in Hz
+    q16_t beta;       // one euro cutoff increase in Hz for each unit/s of speed
+    q16_t d_cutoff;   // one euro cutoff frequency of the speed estimation in Hz
+} filter_param_t;
+
+typedef struct
+{
+    const filter_param_t *param; // parameters of the filter
+    bool started;                // false until the first value
+    uint32_t date_ms;            // systick of the last update
+    q16_t value;                 // filtered value
+    q16_t target;                // last raw value
+    q16_t speed;                 // one euro filtered speed in unit/s, spring speed in unit/ms
+} filter_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+void LightFilter_Init(filter_t *filter, const filter_param_t *param);
+void LightFilter_Reset(filter_t *filter, q16_t value, uint32_t date_ms);
+q16_t LightFilter_Update(filter_t *filter, q16_t target, uint32_t date_ms);
+
+#endif /* LIGHT_FILTER_H */
@@ -0,0 +1,80 @@
+/******************************************************************************
+ * @file light fsm
+ * @brief table driven event state machine
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#include "light_fsm.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+
+/******************************************************************************
+ * @brief init a state machine with an empty queue
+ * @param fsm: state machine
+ * @param table: transitions of each state for each event, row by state
+ * @param event_nb: number of events
+ * @param state: initial state
+ * @return None
+ ******************************************************************************/
+void LightFsm_Init(fsm_t *fsm, const fsm_transition_t *table, uint8_t event_nb, uint8_t state)
+{
+    fsm->table    = table;
+    fsm->event_nb = event_nb;
+    fsm->state    = state;
+    fsm->head     = 0;
+    fsm->tail     = 0;
+}
+
+/******************************************************************************
+ * @brief Queue an event, it is handled on the next dispatch
+ * @param fsm: state machine
+ * @param event: event to queue
+ * @return false if the queue is full or the event unknown
+ ******************************************************************************/
+bool LightFsm_Post(fsm_t *fsm, uint8_t event)
+{
+    if ((event >= fsm->event_nb) || ((uint8_t)(fsm->tail - fsm->head) >= FSM_QUEUE_SIZE))
+    {
+        return false;
+    }
+    fsm->queue[fsm->tail & (FSM_QUEUE_SIZE - 1)] = event;
+    fsm->tail++;
+    return true;
+}
+
+/******************************************************************************
+ * @brief Handle the queued events
+ * @param fsm: state machine
+ * @return None
+ ******************************************************************************/
+void LightFsm_Dispatch(fsm_t *fsm)
+{
+    // Events posted by the actions are handled on the next dispatch, a dispatch
+    // handles at most FSM_QUEUE_SIZE events whatever the size of the table
+    uint8_t event_nb = fsm->tail - fsm->head;
+    while (event_nb-- > 0)
+    {
+        uint8_t event = fsm->queue[fsm->head & (FSM_QUEUE_SIZE - 1)];
+        fsm->head++;
+        const fsm_transition_t *transition = &fsm->table[fsm->state * fsm->event_nb + event];
+        if (transition->next == FSM_STAY)
+        {
+            continue;
+        }
+        if ((transition->action != NULL) && !transition->action())
+        {
+            continue;
+        }
+        fsm->state = transition->next;
+    }
+}
@@ -0,0 +1,50 @@
+/******************************************************************************
+ * @file light fsm
+ * @brief table driven event state machine
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#ifndef LIGHT_FSM_H
+#define LIGHT_FSM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define FSM_QUEUE_SIZE 8    // events waiting to be dispatched, a power of 2
+#define FSM_STAY       0xFF // next state of an event ignored in a state
+
+// Action of a transition, the transition is cancelled if it returns false
+typedef bool (*FSM_ACTION)(void);
+
+typedef struct
+{
+    FSM_ACTION action; // done before changing state, NULL if there is nothing to do
+    uint8_t next;      // state after the transition, FSM_STAY to ignore the event
+} fsm_transition_t;
+
+typedef struct
+{
+    const fsm_transition_t *table; // state_nb x event_nb transitions, row by state
+    uint8_t event_nb;              // number of events of the machine
+    uint8_t state;                 // current state
+    uint8_t queue[FSM_QUEUE_SIZE]; // events posted and not dispatched yet
+    uint8_t head;                  // next event to dispatch
+    uint8_t tail;                  // next free place of the queue
+} fsm_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+void LightFsm_Init(fsm_t *fsm, const fsm_transition_t *table, uint8_t event_nb, uint8_t state);
+bool LightFsm_Post(fsm_t *fsm, uint8_t event);
+void LightFsm_Dispatch(fsm_t *fsm);
+
+#endif /* LIGHT_FSM_H */
@@ -0,0 +1,384 @@
+/******************************************************************************
+ * @file light log
+ * @brief wear leveled log of the light state kept in flash
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#include <stddef.h>
+#include "main.h"
+#include "light_log.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define LOG_PAGE_SIZE     2048
+#define LOG_RECORD_SIZE   64
+#define LOG_HALFWORD_NB   (LOG_RECORD_SIZE / sizeof(uint16_t))
+#define LOG_SLOT_NB       (LOG_PAGE_SIZE / LOG_RECORD_SIZE) // the first slot of a page is its header
+#define LOG_PAGE_MAGIC    0x10C5
+#define LOG_RECORD_MARKER 0x5A5A
+#define LOG_ERASED        0xFFFF
+#define LOG_SETTLE_MS     2000  // a state is logged once it stopped changing for this time
+#define LOG_MAX_DELAY_MS  30000 // a state changing all the time is logged after this time anyway
+#define LOG_PERIOD_MS     10000 // shortest time between 2 records
+#define LOG_PROGRAM_STEP  8     // half words programmed on each loop
+
+typedef struct
+{
+    uint16_t marker;             // LOG_RECORD_MARKER, written last to only consider complete records
+    uint16_t size;               // size of the state
+    uint16_t checksum;           // sum of the state bytes
+    uint8_t data[LOG_DATA_SIZE]; // state
+} log_record_t;
+
+typedef struct
+{
+    uint16_t magic; // LOG_PAGE_MAGIC if the page is used by the log
+    uint16_t seq;   // incremented each time the log goes to the other page
+} log_header_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+// Flash pages
+static uint8_t active_page = 0;     // page the records are appended to
+static uint16_t active_seq = 0;     // sequence number of the active page
+static uint8_t write_slot  = 0;     // next slot to write in the active page
+static bool spare_erased   = false; // the other page is ready to be used
+static bool has_record     = false; // the active page have a complete record, the other page is useless
+// State to log
+static uint8_t log_state[LOG_DATA_SIZE];
+static uint16_t state_size        = 0;
+static bool pending               = false; // the state changed since the last record
+static uint32_t change_date       = 0;     // systick of the last state change
+static uint32_t first_change_date = 0;     // systick of the first change since the last record
+static uint32_t write_date        = 0;     // systick of the last record
+// Record being written
+static log_record_t record;
+static bool writing          = false;
+static uint8_t program_index = 0; // half words of the record already written
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+static uint32_t LightLog_PageAddress(uint8_t page);
+static bool LightLog_PageValid(uint8_t page);
+static uint8_t LightLog_FindEnd(uint8_t page);
+static const log_record_t *LightLog_LastRecord(uint8_t page, uint8_t end);
+static bool LightLog_IsErased(uint32_t address, uint16_t size);
+static bool LightLog_StartPage(void);
+static void LightLog_Program(void);
+static uint16_t LightLog_Checksum(const uint8_t *data, uint16_t size);
+
+/******************************************************************************
+ * @brief init the log from the flash
+ * @param None
+ * @return None
+ ******************************************************************************/
+void LightLog_Init(void)
+{
+    bool valid[2] = {LightLog_PageValid(0), LightLog_PageValid(1)};
+    if (valid[0] || valid[1])
+    {
+        // The active page is the one with the newest sequence number
+        const log_header_t *header0 = (const log_header_t *)LightLog_PageAddress(0);
+        const log_header_t *header1 = (const log_header_t *)LightLog_PageAddress(1);
+        active_page                 = (valid[0] && valid[1]) ? ((int16_t)(header1->seq - header0->seq) > 0) : valid[1];
+        active_seq                  = ((const log_header_t *)LightLog_PageAddress(active_page))->seq;
+        write_slot                  = LightLog_FindEnd(active_page);
+        has_record                  = (LightLog_LastRecord(active_page, write_slot) != NULL);
+    }
+    else
+    {
+        // There is no log yet, act as if the page 1 was full to start on the page 0
+        active_page = 1;
+        active_seq  = LOG_ERASED;
+        write_slot  = LOG_SLOT_NB;
+        has_record  = true;
+    }
+    spare_erased = LightLog_IsErased(LightLog_PageAddress(1 - active_page), LOG_PAGE_SIZE);
+    memset(log_state, 0, sizeof(log_state));
+    state_size = 0;
+    pending    = false;
+    writing    = false;
+}
+
+/******************************************************************************
+ * @brief Get the last state logged
+ * @param state: state to fill
+ * @param size: size of the state
+ * @return false if there is no state of this size logged
+ ******************************************************************************/
+bool LightLog_Restore(void *state, uint16_t size)
+{
+    if (size > LOG_DATA_SIZE)
+    {
+        return false;
+    }
+    // The last record is at the end of the active page, or at the end of the previous
+    // page if nothing have been written in the active one yet
+    const log_record_t *last = NULL;
+    if (LightLog_PageValid(active_page))
+    {
+        last = LightLog_LastRecord(active_page, write_slot);
+    }
+    if ((last == NULL) && LightLog_PageValid(1 - active_page))
+    {
+        last = LightLog_LastRecord(1 - active_page, LightLog_FindEnd(1 - active_page));
+    }
+    if ((last == NULL) || (last->size != size))
+    {
+        return false;
+    }
+    memcpy(state, last->data, size);
+    // This state is already logged
+    memcpy(log_state, last->data, size);
+    state_size = size;
+    return true;
+}
+
+/******************************************************************************
+ * @brief Give the current state, it is logged later if it changed
+ * @param state: current state
+ * @param size: size of the state
+ * @param date_ms: current systick
+ * @return None
+ ******************************************************************************/
+void LightLog_Write(const void *state, uint16_t size, uint32_t date_ms)
+{
+    if ((size > LOG_DATA_SIZE) || ((size == state_size) && (memcmp(state, log_state, size) == 0)))
+    {
+        return;
+    }
+    memcpy(log_state, state, size);
+    state_size = size;
+    if (!pending)
+    {
+        first_change_date = date_ms;
+    }
+    pending     = true;
+    change_date = date_ms;
+}
+
+/******************************************************************************
+ * @brief Write the log a bit at a time, must be call in the project loop
+ * @param date_ms: current systick
+ * @param idle: the light is not moving, the CPU can be stalled by a flash erase
+ * @return None
+ ******************************************************************************/
+void LightLog_Loop(uint32_t date_ms, bool idle)
+{
+    if (writing)
+    {
+        LightLog_Program();
+        return;
+    }
+    // The previous page is erased in advance, once the active one have a record
+    if (!spare_erased && idle && has_record)
+    {
+        FLASH_EraseInitTypeDef erase = {
+            .TypeErase   = FLASH_TYPEERASE_PAGES,
+            .PageAddress = LightLog_PageAddress(1 - active_page),
+            .NbPages     = 1,
+        };
+        uint32_t page_error = 0;
+        HAL_FLASH_Unlock();
+        spare_erased = (HAL_FLASHEx_Erase(&erase, &page_error) == HAL_OK);
+        HAL_FLASH_Lock();
+        return;
+    }
+    // Batch the changes, a moving light is only logged once it stopped
+    if (!pending
+        || ((date_ms - change_date < LOG_SETTLE_MS) && (date_ms - first_change_date < LOG_MAX_DELAY_MS))
+        || (date_ms - write_date < LOG_PERIOD_MS))
+    {
+        return;
+    }
+    if ((write_slot >= LOG_SLOT_NB) && !LightLog_StartPage())
+    {
+        // Wait for the other page to be erased
+        return;
+    }
+    uint32_t address = LightLog_PageAddress(active_page) + write_slot * LOG_RECORD_SIZE;
+    if (!LightLog_IsErased(address, LOG_RECORD_SIZE))
+    {
+        // This slot have been partially written before a reset, use the next one
+        write_slot++;
+        return;
+    }
+    memset(&record, 0xFF, sizeof(log_record_t));
+    memcpy(record.data, log_state, state_size);
+    record.marker   = LOG_RECORD_MARKER;
+    record.size     = state_size;
+    record.checksum = LightLog_Checksum(log_state, state_size);
+    program_index   = 0;
+    writing         = true;
+    pending         = false;
+    write_date      = date_ms;
+    LightLog_Program();
+}
+
+/******************************************************************************
+ * @brief Get the address of a log page
+ * @param page: log page
+ * @return address of the page
+ ******************************************************************************/
+static uint32_t LightLog_PageAddress(uint8_t page)
+{
+    return LOG_FLASH_ADDRESS + page * LOG_PAGE_SIZE;
+}
+
+/******************************************************************************
+ * @brief Check if a page is used by the log
+ * @param page: log page
+ * @return true if the page have a log header
+ ******************************************************************************/
+static bool LightLog_PageValid(uint8_t page)
+{
+    return (((const log_header_t *)LightLog_PageAddress(page))->magic == LOG_PAGE_MAGIC);
+}
+
+/******************************************************************************
+ * @brief Find the first never written slot of a page
+ * @param page: log page
+ * @return slot index, LOG_SLOT_NB if the page is full
+ ******************************************************************************/
+static uint8_t LightLog_FindEnd(uint8_t page)
+{
+    // Slots are written in order, the never written ones are at the end of the page
+    uint8_t low  = 1;
+    uint8_t high = LOG_SLOT_NB;
+    while (low < high)
+    {
+        uint8_t middle = (low + high) / 2;
+        if (LightLog_IsErased(LightLog_PageAddress(page) + middle * LOG_RECORD_SIZE, LOG_RECORD_SIZE))
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+    return low;
+}
+
+/******************************************************************************
+ * @brief Get the last complete record of a page
+ * @param page: log page
+ * @param end: first never written slot of the page
+ * @return record, NULL if there is none
+ ******************************************************************************/
+static const log_record_t *LightLog_LastRecord(uint8_t page, uint8_t end)
+{
+    // Only a reset while writing leave an incomplete record, the last one is usually complete
+    for (uint8_t slot = end - 1; slot > 0; slot--)
+    {
+        const log_record_t *last = (const log_record_t *)(LightLog_PageAddress(page) + slot * LOG_RECORD_SIZE);
+        if ((last->marker == LOG_RECORD_MARKER) && (last->size <= LOG_DATA_SIZE) && (last->checksum == LightLog_Checksum(last->data, last->size)))
+        {
+            return last;
+        }
+    }
+    return NULL;
+}
+
+/******************************************************************************
+ * @brief Check if a flash area is erased
+ * @param address: start of the area
+ * @param size: size of the area
+ * @return true if the area can be written
+ ******************************************************************************/
+static bool LightLog_IsErased(uint32_t address, uint16_t size)
+{
+    const uint32_t *word = (const uint32_t *)address;
+    for (uint16_t i = 0; i < size / sizeof(uint32_t); i++)
+    {
+        if (word[i] != 0xFFFFFFFF)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/******************************************************************************
+ * @brief Go to the other page, it have to be erased
+ * @param None
+ * @return false if the page can't be used yet
+ ******************************************************************************/
+static bool LightLog_StartPage(void)
+{
+    if (!spare_erased)
+    {
+        return false;
+    }
+    uint8_t page     = 1 - active_page;
+    uint32_t address = LightLog_PageAddress(page);
+    // The magic is written last for the page to only be used once its sequence number is written
+    HAL_FLASH_Unlock();
+    bool result = (HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, address + offsetof(log_header_t, seq), (uint16_t)(active_seq + 1)) == HAL_OK)
+                  && (HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, address + offsetof(log_header_t, magic), LOG_PAGE_MAGIC) == HAL_OK);
+    HAL_FLASH_Lock();
+    // The previous page have to be erased again before being used
+    spare_erased = false;
+    if (!result)
+    {
+        // Stay on the full page, the other one will be erased again
+        return false;
+    }
+    active_page = page;
+    active_seq++;
+    write_slot = 1;
+    has_record = false;
+    return true;
+}
+
+/******************************************************************************
+ * @brief Write the next half words of the record
+ * @param None
+ * @return None
+ ******************************************************************************/
+static void LightLog_Program(void)
+{
+    uint32_t address     = LightLog_PageAddress(active_page) + write_slot * LOG_RECORD_SIZE;
+    const uint16_t *data = (const uint16_t *)&record;
+    HAL_FLASH_Unlock();
+    for (uint8_t n = 0; (n < LOG_PROGRAM_STEP) && writing; n++)
+    {
+        // The marker is the first half word and is written last
+        uint8_t i = (program_index + 1) % LOG_HALFWORD_NB;
+        if ((data[i] != LOG_ERASED) && (HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, address + i * sizeof(uint16_t), data[i]) != HAL_OK))
+        {
+            // Give up this slot, the state will be written in the next one
+            write_slot++;
+            writing = false;
+            pending = true;
+            break;
+        }
+        program_index++;
+        if (program_index == LOG_HALFWORD_NB)
+        {
+            write_slot++;
+            writing    = false;
+            has_record = true;
+        }
+    }
+    HAL_FLASH_Lock();
+}
+
+/******************************************************************************
+ * @brief Sum the bytes of a state
+ * @param data: state
+ * @param size: size of the state
+ * @return checksum
+ ******************************************************************************/
+static uint16_t LightLog_Checksum(const uint8_t *data, uint16_t size)
+{
+    uint16_t sum = 0;
+    for (uint16_t i = 0; i < size; i++)
+    {
+        sum = (sum << 1 | sum >> 15) + data[i];
+    }
+    return sum;
+}
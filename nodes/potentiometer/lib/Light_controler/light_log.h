@@ -0,0 +1,32 @@
+/******************************************************************************
+ * @file light log
+ * @brief wear leveled log of the light state kept in flash
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#ifndef LIGHT_LOG_H
+#define LIGHT_LOG_H
+
+#include "luos_engine.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#ifndef LOG_FLASH_ADDRESS
+    #define LOG_FLASH_ADDRESS 0x0801E000 // 2 flash pages reserved to the log
+#endif
+#define LOG_DATA_SIZE 58 // biggest state that can be logged in bytes
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+void LightLog_Init(void);
+bool LightLog_Restore(void *state, uint16_t size);
+void LightLog_Write(const void *state, uint16_t size, uint32_t date_ms);
+void LightLog_Loop(uint32_t date_ms, bool idle);
+
+#endif /* LIGHT_LOG_H */
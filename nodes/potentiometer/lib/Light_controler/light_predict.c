@@ -0,0 +1,91 @@
+/******************************************************************************
+ * @file light predict
+ * @brief extrapolation of a sampled input to compensate the latency
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#include "light_predict.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+
+/******************************************************************************
+ * @brief init a prediction, it starts on the first sample
+ * @param predict: prediction to init
+ * @return None
+ ******************************************************************************/
+void LightPredict_Init(predict_t *predict)
+{
+    memset(predict, 0, sizeof(predict_t));
+}
+
+/******************************************************************************
+ * @brief Add a sample and update the speed
+ * @param predict: prediction to update
+ * @param value: sampled value
+ * @param date_ms: systick the value have been measured at, not the one it has been received at
+ * @return None
+ ******************************************************************************/
+void LightPredict_Sample(predict_t *predict, q16_t value, uint32_t date_ms)
+{
+    int32_t dt_ms = (int32_t)(date_ms - predict->date_ms);
+    if (predict->started && (dt_ms <= 0))
+    {
+        // Late or duplicated sample, the last one is more recent
+        return;
+    }
+    if (!predict->started || (dt_ms > PREDICT_MAX_GAP_MS))
+    {
+        // Nothing recent to compare with, consider the input steady
+        predict->speed = 0;
+    }
+    else
+    {
+        q16_t speed = (q16_t)(((int64_t)value - predict->value) / dt_ms);
+        if (((speed >= 0) && (speed < predict->speed)) || ((speed <= 0) && (speed > predict->speed)))
+        {
+            // Follow a slow down right away to not overshoot when the hand stops
+            predict->speed = speed;
+        }
+        else
+        {
+            // Average the acceleration over the last samples, the raw speed is noisy
+            predict->speed += (speed - predict->speed) / 2;
+        }
+    }
+    predict->started = true;
+    predict->date_ms = date_ms;
+    predict->value   = value;
+}
+
+/******************************************************************************
+ * @brief Compute how far the input moved since its last sample
+ * @param predict: prediction to use
+ * @param date_ms: current systick
+ * @param latency_ms: time until the result is visible
+ * @return value to add to the last sample to get the value at date_ms + latency_ms
+ ******************************************************************************/
+q16_t LightPredict_Offset(const predict_t *predict, uint32_t date_ms, uint32_t latency_ms)
+{
+    uint32_t age_ms = date_ms - predict->date_ms;
+    if (!predict->started || (age_ms > PREDICT_MAX_LEAD_MS))
+    {
+        // The input stopped sending, don't extrapolate further
+        return 0;
+    }
+    uint32_t lead_ms = age_ms + latency_ms;
+    if (lead_ms > PREDICT_MAX_LEAD_MS)
+    {
+        lead_ms = PREDICT_MAX_LEAD_MS;
+    }
+    return (q16_t)((int64_t)predict->speed * lead_ms);
+}
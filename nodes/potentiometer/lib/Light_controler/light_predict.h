@@ -0,0 +1,37 @@
+/******************************************************************************
+ * @file light predict
+ * @brief extrapolation of a sampled input to compensate the latency
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#ifndef LIGHT_PREDICT_H
+#define LIGHT_PREDICT_H
+
+#include "light_render.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define PREDICT_MAX_GAP_MS  100 // samples further apart than this are not used to compute a speed
+#define PREDICT_MAX_LEAD_MS 80  // longest extrapolation, the prediction stops after the last sample is this old
+
+typedef struct
+{
+    bool started;     // false until the first sample
+    uint32_t date_ms; // systick the last sample have been measured at
+    q16_t value;      // last sample
+    q16_t speed;      // filtered speed in unit/ms
+} predict_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+void LightPredict_Init(predict_t *predict);
+void LightPredict_Sample(predict_t *predict, q16_t value, uint32_t date_ms);
+q16_t LightPredict_Offset(const predict_t *predict, uint32_t date_ms, uint32_t latency_ms);
+
+#endif /* LIGHT_PREDICT_H */
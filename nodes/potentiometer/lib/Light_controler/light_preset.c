@@ -0,0 +1,143 @@
+/******************************************************************************
+ * @file light preset
+ * @brief scene presets kept in a flash page
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#include "main.h"
+#include "light_preset.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define PRESET_MAGIC 0x5CE0 // mark of a stored preset, erased flash read 0xFFFF
+
+typedef struct
+{
+    uint16_t magic;                 // PRESET_MAGIC if the slot contain a scene
+    uint16_t size;                  // size of the scene, a scene of another size is ignored
+    uint16_t checksum;              // sum of the scene bytes, a scene partially written is ignored
+    uint16_t reserved;              // keep the data aligned
+    uint8_t data[PRESET_DATA_SIZE]; // scene
+} preset_slot_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+// Copy of the flash page, the page have to be erased to change a single preset
+static preset_slot_t presets[PRESET_NB];
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+static uint16_t LightPreset_Checksum(const uint8_t *data, uint16_t size);
+static bool LightPreset_Write(void);
+
+/******************************************************************************
+ * @brief init the presets from the flash
+ * @param None
+ * @return None
+ ******************************************************************************/
+void LightPreset_Init(void)
+{
+    memcpy(presets, (const void *)PRESET_FLASH_ADDRESS, sizeof(presets));
+}
+
+/******************************************************************************
+ * @brief Store a scene in flash
+ * @param index: preset to store the scene in
+ * @param scene: scene to store
+ * @param size: size of the scene
+ * @return false if the scene can't be stored
+ ******************************************************************************/
+bool LightPreset_Save(uint8_t index, const void *scene, uint16_t size)
+{
+    if ((index >= PRESET_NB) || (size > PRESET_DATA_SIZE))
+    {
+        return false;
+    }
+    preset_slot_t *slot = &presets[index];
+    if ((slot->magic == PRESET_MAGIC) && (slot->size == size) && (memcmp(slot->data, scene, size) == 0))
+    {
+        // This scene is already stored, avoid wearing the flash
+        return true;
+    }
+    memset(slot, 0xFF, sizeof(preset_slot_t));
+    memcpy(slot->data, scene, size);
+    slot->magic    = PRESET_MAGIC;
+    slot->size     = size;
+    slot->checksum = LightPreset_Checksum(slot->data, size);
+    slot->reserved = 0;
+    return LightPreset_Write();
+}
+
+/******************************************************************************
+ * @brief Get a scene stored in flash
+ * @param index: preset to get
+ * @param scene: scene to fill
+ * @param size: size of the scene
+ * @return false if there is no valid scene of this size in this preset
+ ******************************************************************************/
+bool LightPreset_Load(uint8_t index, void *scene, uint16_t size)
+{
+    if (index >= PRESET_NB)
+    {
+        return false;
+    }
+    const preset_slot_t *slot = &presets[index];
+    if ((slot->magic != PRESET_MAGIC) || (slot->size != size) || (slot->checksum != LightPreset_Checksum(slot->data, size)))
+    {
+        return false;
+    }
+    memcpy(scene, slot->data, size);
+    return true;
+}
+
+/******************************************************************************
+ * @brief Sum the bytes of a scene
+ * @param data: scene
+ * @param size: size of the scene
+ * @return checksum
+ ******************************************************************************/
+static uint16_t LightPreset_Checksum(const uint8_t *data, uint16_t size)
+{
+    uint16_t sum = 0;
+    for (uint16_t i = 0; i < size; i++)
+    {
+        sum = (sum << 1 | sum >> 15) + data[i];
+    }
+    return sum;
+}
+
+/******************************************************************************
+ * @brief Erase the preset page and write every preset in it
+ * @param None
+ * @return false if the flash can't be written
+ ******************************************************************************/
+static bool LightPreset_Write(void)
+{
+    FLASH_EraseInitTypeDef erase = {
+        .TypeErase   = FLASH_TYPEERASE_PAGES,
+        .PageAddress = PRESET_FLASH_ADDRESS,
+        .NbPages     = 1,
+    };
+    uint32_t page_error = 0;
+    bool result         = true;
+
+    HAL_FLASH_Unlock();
+    if (HAL_FLASHEx_Erase(&erase, &page_error) != HAL_OK)
+    {
+        result = false;
+    }
+    // The flash is written by half word
+    const uint16_t *data = (const uint16_t *)presets;
+    for (uint16_t i = 0; result && (i < PRESET_NB * sizeof(preset_slot_t) / sizeof(uint16_t)); i++)
+    {
+        if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, PRESET_FLASH_ADDRESS + i * sizeof(uint16_t), data[i]) != HAL_OK)
+        {
+            result = false;
+        }
+    }
+    HAL_FLASH_Lock();
+    return result;
+}
@@ -0,0 +1,32 @@
+/******************************************************************************
+ * @file light preset
+ * @brief scene presets kept in a flash page
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#ifndef LIGHT_PRESET_H
+#define LIGHT_PRESET_H
+
+#include "luos_engine.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#ifndef PRESET_FLASH_ADDRESS
+    #define PRESET_FLASH_ADDRESS 0x0801F000 // flash page reserved to the presets, just before the Luos alias page
+#endif
+#define PRESET_NB        4  // scenes that can be stored
+#define PRESET_DATA_SIZE 56 // biggest scene that can be stored in bytes
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+void LightPreset_Init(void);
+bool LightPreset_Save(uint8_t index, const void *scene, uint16_t size);
+bool LightPreset_Load(uint8_t index, void *scene, uint16_t size);
+
+#endif /* LIGHT_PRESET_H */
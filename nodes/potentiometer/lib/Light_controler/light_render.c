@@ -0,0 +1,373 @@
+/******************************************************************************
+ * @file light render
+ * @brief fixed point rendering of the light on the led strip
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#include "light_render.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+// 4 pixels are written as 3 words
+typedef uint32_t __attribute__((__may_alias__)) pixel_word_t;
+
+// Number of steps of the kernel tables between the center and the radius of a spot
+#define KERNEL_STEPS 64
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+// Integral of each falloff kernel from the center to each step, in Q16.16 of radius
+static const uint16_t kernel_integral[RENDER_KERNEL_NB][KERNEL_STEPS + 1] = {
+    [RENDER_KERNEL_LINEAR] = {
+        0, 1016, 2016, 3000, 3968, 4920, 5856, 6776, 7680, 8568, 9440, 10296, 11136, 11960,
+        12768, 13560, 14336, 15096, 15840, 16568, 17280, 17976, 18656, 19320, 19968, 20600,
+        21216, 21816, 22400, 22968, 23520, 24056, 24576, 25080, 25568, 26040, 26496, 26936,
+        27360, 27768, 28160, 28536, 28896, 29240, 29568, 29880, 30176, 30456, 30720, 30968,
+        31200, 31416, 31616, 31800, 31968, 32120, 32256, 32376, 32480, 32568, 32640, 32696,
+        32736, 32760, 32768},
+    [RENDER_KERNEL_GAUSSIAN] = {
+        0, 1024, 2046, 3065, 4079, 5086, 6086, 7076, 8055, 9021, 9974, 10911, 11832, 12736,
+        13621, 14486, 15331, 16154, 16955, 17732, 18487, 19217, 19923, 20603, 21259, 21890,
+        22495, 23074, 23629, 24158, 24663, 25142, 25598, 26029, 26437, 26822, 27184, 27525,
+        27844, 28143, 28422, 28681, 28922, 29145, 29350, 29540, 29714, 29872, 30017, 30148,
+        30266, 30372, 30466, 30550, 30624, 30688, 30743, 30790, 30829, 30860, 30885, 30904,
+        30916, 30924, 30926},
+    [RENDER_KERNEL_COSINE] = {
+        0, 1024, 2046, 3066, 4083, 5094, 6100, 7098, 8088, 9068, 10037, 10994, 11939, 12869,
+        13785, 14685, 15567, 16432, 17279, 18106, 18913, 19698, 20463, 21205, 21924, 22621,
+        23293, 23942, 24566, 25165, 25740, 26290, 26814, 27314, 27788, 28237, 28662, 29062,
+        29437, 29789, 30116, 30421, 30703, 30962, 31201, 31418, 31615, 31792, 31951, 32093,
+        32217, 32325, 32419, 32498, 32565, 32620, 32664, 32698, 32724, 32742, 32755, 32762,
+        32766, 32768, 32768},
+    [RENDER_KERNEL_FLAT_TOP] = {
+        0, 1024, 2048, 3072, 4096, 5120, 6144, 7168, 8192, 9216, 10240, 11264, 12288, 13312,
+        14336, 15360, 16384, 17408, 18432, 19456, 20480, 21504, 22528, 23552, 24576, 25600,
+        26624, 27648, 28672, 29696, 30720, 31744, 32768, 33792, 34816, 35840, 36864, 37888,
+        38912, 39936, 40960, 41984, 43008, 44032, 45056, 46080, 47100, 48104, 49078, 50011,
+        50890, 51707, 52453, 53121, 53708, 54212, 54632, 54972, 55235, 55429, 55562, 55645,
+        55687, 55703, 55706},
+};
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+static void LightRender_Profile(render_profile_t *profile, uint16_t led_nb, const render_spot_t *spot);
+static q16_t LightRender_Coverage(q16_t offset, q16_t radius, uint64_t inv_radius, const uint16_t *integral);
+static uint16_t LightRender_Weight(q16_t weight);
+static inline uint32_t LightRender_Scale(uint32_t level_rb, uint32_t level_g, uint32_t weight);
+static inline void LightRender_Write(color_t *pixel, uint32_t packed);
+static void LightRender_Fade(color_t *pixel, color_t overlay, q16_t overlay_ratio);
+static void LightRender_AddOverlay(color_t *pixel, color_t overlay, q16_t overlay_ratio);
+static void LightRender_AddSpot(color_t *pic, const render_spot_t *spot, const render_profile_t *profile);
+static inline uint32_t LightRender_Read(const color_t *pixel);
+static inline uint32_t LightRender_Add(uint32_t pixel, uint32_t light);
+
+/******************************************************************************
+ * @brief Render spots added together, their falloff is only computed again if their geometry changed
+ *
+ * @param pic: picture to fill, aligned on 4 bytes to be written by words
+ * @param led_nb: number of led of the picture
+ * @param spots: table of spots to render
+ * @param profiles: table of falloff weights cache, one for each spot, each with a table of led_nb weights
+ * @param spot_nb: number of spots
+ * @return None
+ ******************************************************************************/
+void LightRender_Spots(color_t *pic, uint16_t led_nb, const render_spot_t *spots, render_profile_t *profiles, uint8_t spot_nb)
+{
+    memset(pic, 0, led_nb * sizeof(color_t));
+    for (uint8_t i = 0; i < spot_nb; i++)
+    {
+        const render_spot_t *spot = &spots[i];
+        render_profile_t *profile = &profiles[i];
+        if (!profile->valid || (profile->led_nb != led_nb) || (profile->center != spot->center) || (profile->radius != spot->radius)
+            || (profile->kernel != spot->kernel))
+        {
+            LightRender_Profile(profile, led_nb, spot);
+        }
+        // Only the leds lit by the spot are touched
+        if (spot->intensity > 0)
+        {
+            LightRender_AddSpot(pic, spot, profile);
+        }
+    }
+}
+
+/******************************************************************************
+ * @brief Composite overlay layers over a rendered picture, in order
+ *
+ * @param pic: picture rendered by the base layer
+ * @param led_nb: number of led of the picture
+ * @param layers: layers to put over the picture
+ * @param layer_nb: number of layers
+ * @return None
+ ******************************************************************************/
+void LightRender_Composite(color_t *pic, uint16_t led_nb, const render_layer_t *layers, uint8_t layer_nb)
+{
+    for (uint8_t i = 0; i < layer_nb; i++)
+    {
+        const render_layer_t *layer = &layers[i];
+        if (layer->opacity <= 0)
+        {
+            continue;
+        }
+        // Only the pixels covered by the layer are touched
+        int first = (layer->first_led < 0) ? 0 : layer->first_led;
+        int last  = layer->first_led + layer->led_nb - 1;
+        if (last >= led_nb)
+        {
+            last = led_nb - 1;
+        }
+        q16_t opacity = (layer->opacity > Q16_ONE) ? Q16_ONE : layer->opacity;
+        for (int led = first; led <= last; led++)
+        {
+            switch (layer->blend)
+            {
+                case RENDER_BLEND_FADE:
+                    LightRender_Fade(&pic[led], layer->color, opacity);
+                    break;
+                case RENDER_BLEND_ADD:
+                    LightRender_AddOverlay(&pic[led], layer->color, opacity);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+/******************************************************************************
+ * @brief Add a spot to the picture on the leds it light
+ *
+ * @param pic: picture to add the spot to, written by words only if it is aligned on 4 bytes
+ * @param spot: spot to render
+ * @param profile: falloff weights of this spot
+ * @return None
+ ******************************************************************************/
+static void LightRender_AddSpot(color_t *pic, const render_spot_t *spot, const render_profile_t *profile)
+{
+    // Scale the color by the intensity once, leds only have to apply their weight
+    // Red and blue are packed in the 2 lanes of a word to be scaled with a single multiplication
+    uint32_t intensity = (spot->intensity > Q16_ONE) ? Q16_ONE : spot->intensity;
+    uint32_t level_rb  = ((spot->color.r * intensity + 0x8000) >> 16) | (((spot->color.b * intensity + 0x8000) >> 16) << 16);
+    uint32_t level_g   = (spot->color.g * intensity + 0x8000) >> 16;
+    int led            = profile->first;
+    // An unaligned picture is only written by bytes, the word accesses would fault on the Cortex-M0
+    bool aligned = (((uintptr_t)pic & 3) == 0);
+    // Single leds up to a group of 4 leds aligned on a word
+    for (; (led <= profile->last) && (led & 3); led++)
+    {
+        LightRender_Write(&pic[led], LightRender_Add(LightRender_Read(&pic[led]), LightRender_Scale(level_rb, level_g, profile->weight[led])));
+    }
+    // Groups of 4 leds are read and written as 3 words
+    for (; aligned && (led + 3 <= profile->last); led += 4)
+    {
+        pixel_word_t *word = (pixel_word_t *)&pic[led];
+        uint32_t p0        = word[0] & 0x00FFFFFF;
+        uint32_t p1        = (word[0] >> 24) | ((word[1] & 0x0000FFFF) << 8);
+        uint32_t p2        = (word[1] >> 16) | ((word[2] & 0x000000FF) << 16);
+        uint32_t p3        = word[2] >> 8;
+        p0                 = LightRender_Add(p0, LightRender_Scale(level_rb, level_g, profile->weight[led]));
+        p1                 = LightRender_Add(p1, LightRender_Scale(level_rb, level_g, profile->weight[led + 1]));
+        p2                 = LightRender_Add(p2, LightRender_Scale(level_rb, level_g, profile->weight[led + 2]));
+        p3                 = LightRender_Add(p3, LightRender_Scale(level_rb, level_g, profile->weight[led + 3]));
+        word[0]            = p0 | (p1 << 24);
+        word[1]            = (p1 >> 8) | (p2 << 16);
+        word[2]            = (p2 >> 16) | (p3 << 8);
+    }
+    // Remaining single leds
+    for (; led <= profile->last; led++)
+    {
+        LightRender_Write(&pic[led], LightRender_Add(LightRender_Read(&pic[led]), LightRender_Scale(level_rb, level_g, profile->weight[led])));
+    }
+}
+
+/******************************************************************************
+ * @brief Fade an overlay color over a pixel
+ *
+ * @param pixel: pixel to modify
+ * @param overlay: color to put over the pixel
+ * @param overlay_ratio: between 0 (only the pixel) and Q16_ONE (only the overlay)
+ * @return None
+ ******************************************************************************/
+static void LightRender_Fade(color_t *pixel, color_t overlay, q16_t overlay_ratio)
+{
+    q16_t pixel_ratio = Q16_ONE - overlay_ratio;
+    pixel->r          = (overlay.r * overlay_ratio + pixel->r * pixel_ratio) >> 16;
+    pixel->g          = (overlay.g * overlay_ratio + pixel->g * pixel_ratio) >> 16;
+    pixel->b          = (overlay.b * overlay_ratio + pixel->b * pixel_ratio) >> 16;
+}
+
+/******************************************************************************
+ * @brief Add an overlay color to a pixel, saturating each channel
+ *
+ * @param pixel: pixel to modify
+ * @param overlay: color to add to the pixel
+ * @param overlay_ratio: between 0 and Q16_ONE, part of the overlay added
+ * @return None
+ ******************************************************************************/
+static void LightRender_AddOverlay(color_t *pixel, color_t overlay, q16_t overlay_ratio)
+{
+    uint32_t r = pixel->r + ((overlay.r * overlay_ratio) >> 16);
+    uint32_t g = pixel->g + ((overlay.g * overlay_ratio) >> 16);
+    uint32_t b = pixel->b + ((overlay.b * overlay_ratio) >> 16);
+    pixel->r   = (r > 255) ? 255 : r;
+    pixel->g   = (g > 255) ? 255 : g;
+    pixel->b   = (b > 255) ? 255 : b;
+}
+
+/******************************************************************************
+ * @brief Compute the falloff weights of a spot at subpixel precision
+ *
+ * @param profile: weights to compute
+ * @param led_nb: number of led of the picture
+ * @param spot: spot to compute the weights of
+ * @return None
+ ******************************************************************************/
+static void LightRender_Profile(render_profile_t *profile, uint16_t led_nb, const render_spot_t *spot)
+{
+    q16_t center    = spot->center;
+    q16_t radius    = spot->radius;
+    profile->valid  = true;
+    profile->led_nb = led_nb;
+    profile->center = center;
+    profile->radius = radius;
+    profile->kernel = spot->kernel;
+    profile->first  = 0;
+    profile->last   = -1;
+    if (radius <= 0)
+    {
+        return;
+    }
+    // Each led is 1 led wide and centered on its index, its weight is the part of the
+    // falloff kernel it covers. A spot moving by a fraction of led then smoothly moves
+    // light from a led to the next one instead of stepping.
+    int first = ((center - radius - Q16_ONE / 2) >> 16) + 1;
+    int last  = (center + radius + Q16_ONE / 2 - 1) >> 16;
+    if (first < 0)
+    {
+        first = 0;
+    }
+    if (last >= led_nb)
+    {
+        last = led_nb - 1;
+    }
+    profile->first = first;
+    profile->last  = last;
+
+    // The kernel is scaled by the radius, 1 / radius is computed once and the coverage
+    // of each led border only need multiplications and a table lookup
+    const uint16_t *integral = kernel_integral[(spot->kernel < RENDER_KERNEL_NB) ? spot->kernel : RENDER_KERNEL_LINEAR];
+    uint64_t inv_radius      = ((uint64_t)1 << 48) / (uint64_t)radius;
+    q16_t coverage           = LightRender_Coverage((first << 16) - Q16_ONE / 2 - center, radius, inv_radius, integral);
+    for (int led = first; led <= last; led++)
+    {
+        q16_t next_coverage  = LightRender_Coverage((led << 16) + Q16_ONE / 2 - center, radius, inv_radius, integral);
+        profile->weight[led] = LightRender_Weight(next_coverage - coverage);
+        coverage             = next_coverage;
+    }
+}
+
+/******************************************************************************
+ * @brief Integral of the falloff of a spot up to a position
+ *
+ * @param offset: position from the center of the spot in led
+ * @param radius: radius of the spot in led
+ * @param inv_radius: 1 / radius in Q16.48
+ * @param integral: kernel integral table
+ * @return falloff covered up to the position
+ ******************************************************************************/
+static q16_t LightRender_Coverage(q16_t offset, q16_t radius, uint64_t inv_radius, const uint16_t *integral)
+{
+    // The kernel is symmetrical, each half cover the area of the table scaled by the radius
+    q16_t half     = ((int64_t)radius * integral[KERNEL_STEPS]) >> 16;
+    q16_t distance = (offset < 0) ? -offset : offset;
+    q16_t area     = half;
+    if (distance < radius)
+    {
+        // Distance in Q0.32 of radius, interpolated between the 2 closest steps of the table
+        uint32_t ratio    = ((uint64_t)distance * inv_radius) >> 16;
+        uint32_t step     = ratio >> 26;
+        uint32_t fraction = (ratio >> 10) & 0xFFFF;
+        q16_t value       = integral[step] + (((integral[step + 1] - integral[step]) * fraction) >> 16);
+        area              = ((int64_t)radius * value) >> 16;
+    }
+    return (offset < 0) ? half - area : half + area;
+}
+
+/******************************************************************************
+ * @brief Round and clamp a weight to store it
+ *
+ * @param weight: Q16.16 weight
+ * @return weight between 0 and RENDER_FULL_WEIGHT
+ ******************************************************************************/
+static uint16_t LightRender_Weight(q16_t weight)
+{
+    if (weight <= 0)
+    {
+        return 0;
+    }
+    if (weight >= Q16_ONE)
+    {
+        return RENDER_FULL_WEIGHT;
+    }
+    return (uint16_t)((weight + 0x80) >> 8);
+}
+
+/******************************************************************************
+ * @brief Scale a packed color by a weight
+ *
+ * @param level_rb: red in the low lane, blue in the high lane
+ * @param level_g: green
+ * @param weight: between 0 and RENDER_FULL_WEIGHT
+ * @return pixel packed as 0x00BBGGRR
+ ******************************************************************************/
+static inline uint32_t LightRender_Scale(uint32_t level_rb, uint32_t level_g, uint32_t weight)
+{
+    // Each lane have 8 bits of headroom so red and blue never overflow on each other, even rounded
+    return (((level_rb * weight + 0x00800080) >> 8) & 0x00FF00FF) | ((level_g * weight + 0x80) & 0x0000FF00);
+}
+
+/******************************************************************************
+ * @brief Write a single packed pixel
+ *
+ * @param pixel: pixel to write
+ * @param packed: pixel packed as 0x00BBGGRR
+ * @return None
+ ******************************************************************************/
+static inline void LightRender_Write(color_t *pixel, uint32_t packed)
+{
+    pixel->r = packed;
+    pixel->g = packed >> 8;
+    pixel->b = packed >> 16;
+}
+
+/******************************************************************************
+ * @brief Read a single packed pixel
+ *
+ * @param pixel: pixel to read
+ * @return pixel packed as 0x00BBGGRR
+ ******************************************************************************/
+static inline uint32_t LightRender_Read(const color_t *pixel)
+{
+    return pixel->r | (pixel->g << 8) | (pixel->b << 16);
+}
+
+/******************************************************************************
+ * @brief Add 2 packed pixels, saturating each channel
+ *
+ * @param pixel: pixel packed as 0x00BBGGRR
+ * @param light: light to add packed as 0x00BBGGRR
+ * @return sum packed as 0x00BBGGRR
+ ******************************************************************************/
+static inline uint32_t LightRender_Add(uint32_t pixel, uint32_t light)
+{
+    // Red and blue are added in 16 bits lanes, green alone, so a carry never reach the next channel
+    uint32_t rb = (pixel & 0x00FF00FF) + (light & 0x00FF00FF);
+    uint32_t g  = (pixel & 0x0000FF00) + (light & 0x0000FF00);
+    // A channel overflowing its 8 bits saturate to 255
+    rb |= ((rb & 0x01000100) >> 8) * 0xFF;
+    g |= ((g & 0x00010000) >> 8) * 0xFF;
+    return (rb & 0x00FF00FF) | (g & 0x0000FF00);
+}
@@ -0,0 +1,77 @@
+/******************************************************************************
+ * @file light render
+ * @brief fixed point rendering of the light on the led strip
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#ifndef LIGHT_RENDER_H
+#define LIGHT_RENDER_H
+
+#include "luos_engine.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+// Q16.16 fixed point value
+typedef int32_t q16_t;
+#define Q16_ONE (1 << 16)
+
+#define RENDER_FULL_WEIGHT 256
+
+typedef enum
+{
+    RENDER_KERNEL_LINEAR,   // linear cone
+    RENDER_KERNEL_GAUSSIAN, // gaussian reaching 0 at the radius
+    RENDER_KERNEL_COSINE,   // raised cosine
+    RENDER_KERNEL_FLAT_TOP, // flat up to 70% of the radius then raised cosine edge
+    RENDER_KERNEL_NB
+} render_kernel_t;
+
+typedef struct
+{
+    q16_t center;    // center of the spot in led
+    q16_t radius;    // radius of the spot in led
+    q16_t intensity; // intensity of the spot between 0 and Q16_ONE
+    color_t color;   // color of the spot at full intensity
+    uint8_t kernel;  // render_kernel_t falloff shape of the spot
+} render_spot_t;
+
+typedef struct
+{
+    bool valid;       // false to compute the weights on the next render
+    uint16_t led_nb;  // number of led of the strip
+    q16_t center;     // center of the spot the weights are computed for
+    q16_t radius;     // radius of the spot the weights are computed for
+    uint8_t kernel;   // falloff shape the weights are computed for
+    int16_t first;    // first lit led
+    int16_t last;     // last lit led, lower than first if there is none
+    uint16_t *weight; // table of led_nb falloff weights, RENDER_FULL_WEIGHT at full intensity
+} render_profile_t;
+
+typedef enum
+{
+    RENDER_BLEND_FADE, // fade the layer color over the pixels
+    RENDER_BLEND_ADD,  // add the layer color to the pixels, saturating
+} render_blend_t;
+
+typedef struct
+{
+    int16_t first_led;    // first led covered by the layer
+    int16_t led_nb;       // number of led covered by the layer
+    render_blend_t blend; // how the layer is combined with the pixels under it
+    q16_t opacity;        // between 0 (invisible) and Q16_ONE (only the layer)
+    color_t color;        // color of the layer
+} render_layer_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+// pic should be aligned on 4 bytes to write groups of 4 leds as 3 words, an unaligned pic is written byte by byte
+void LightRender_Spots(color_t *pic, uint16_t led_nb, const render_spot_t *spots, render_profile_t *profiles, uint8_t spot_nb);
+void LightRender_Composite(color_t *pic, uint16_t led_nb, const render_layer_t *layers, uint8_t layer_nb);
+
+#endif /* LIGHT_RENDER_H */
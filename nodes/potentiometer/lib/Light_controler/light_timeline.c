@@ -0,0 +1,228 @@
+/******************************************************************************
+ * @file light timeline
+ * @brief keyframe animation of the light parameters
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#include "light_timeline.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define EASE_ONE (1 << 16) // end of a segment in Q16.16
+
+typedef struct
+{
+    const timeline_key_t *keys; // keys of the track, sorted by date
+    uint8_t key_nb;             // number of keys
+    bool loop;                  // play the track again from the start once finished
+    uint8_t spot;               // spot animated
+    timeline_channel_t channel; // parameter of the spot animated
+    uint32_t start_date;        // systick of the track start
+    uint8_t next_key;           // key reached by the current segment
+} timeline_track_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+// The active tracks are kept at the start of the table, only them are evaluated
+static timeline_track_t tracks[TIMELINE_TRACK_NB];
+static uint8_t track_nb = 0;
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+static bool LightTimeline_Evaluate(timeline_track_t *track, uint32_t date_ms, int32_t *value);
+static int32_t LightTimeline_Ease(uint8_t ease, int32_t ratio);
+static void LightTimeline_Remove(uint8_t index);
+
+/******************************************************************************
+ * @brief init the timeline without any track playing
+ * @param None
+ * @return None
+ ******************************************************************************/
+void LightTimeline_Init(void)
+{
+    memset(tracks, 0, sizeof(tracks));
+    track_nb = 0;
+}
+
+/******************************************************************************
+ * @brief Start playing a track, replacing the one animating the same parameter
+ * @param spot: spot to animate
+ * @param channel: parameter of the spot to animate
+ * @param keys: keys of the track sorted by date, they have to stay available while playing
+ * @param key_nb: number of keys
+ * @param loop: play the track again from the start once finished
+ * @param date_ms: systick of the track start
+ * @return false if there is no track available
+ ******************************************************************************/
+bool LightTimeline_Play(uint8_t spot, timeline_channel_t channel, const timeline_key_t *keys, uint8_t key_nb, bool loop, uint32_t date_ms)
+{
+    if ((key_nb == 0) || (channel >= TIMELINE_CHANNEL_NB))
+    {
+        return false;
+    }
+    uint8_t index = 0;
+    while ((index < track_nb) && ((tracks[index].spot != spot) || (tracks[index].channel != channel)))
+    {
+        index++;
+    }
+    if (index == TIMELINE_TRACK_NB)
+    {
+        return false;
+    }
+    if (index == track_nb)
+    {
+        track_nb++;
+    }
+    tracks[index].keys       = keys;
+    tracks[index].key_nb     = key_nb;
+    tracks[index].loop       = loop;
+    tracks[index].spot       = spot;
+    tracks[index].channel    = channel;
+    tracks[index].start_date = date_ms;
+    tracks[index].next_key   = 1;
+    return true;
+}
+
+/******************************************************************************
+ * @brief Stop every track animating a spot, the parameters keep their current value
+ * @param spot: spot to stop animating
+ * @return None
+ ******************************************************************************/
+void LightTimeline_Stop(uint8_t spot)
+{
+    uint8_t index = 0;
+    while (index < track_nb)
+    {
+        if (tracks[index].spot == spot)
+        {
+            LightTimeline_Remove(index);
+        }
+        else
+        {
+            index++;
+        }
+    }
+}
+
+/******************************************************************************
+ * @brief Check if a track is playing
+ * @param None
+ * @return true if at least one track is playing
+ ******************************************************************************/
+bool LightTimeline_IsPlaying(void)
+{
+    return (track_nb > 0);
+}
+
+/******************************************************************************
+ * @brief Evaluate the active tracks and give their value, the finished ones are removed
+ * @param date_ms: current systick
+ * @param apply: function called with the value of each track
+ * @return None
+ ******************************************************************************/
+void LightTimeline_Update(uint32_t date_ms, TIMELINE_APPLY apply)
+{
+    uint8_t index = 0;
+    while (index < track_nb)
+    {
+        int32_t value;
+        bool finished = LightTimeline_Evaluate(&tracks[index], date_ms, &value);
+        apply(tracks[index].spot, tracks[index].channel, value);
+        if (finished)
+        {
+            LightTimeline_Remove(index);
+        }
+        else
+        {
+            index++;
+        }
+    }
+}
+
+/******************************************************************************
+ * @brief Compute the value of a track at a date
+ * @param track: track to evaluate
+ * @param date_ms: current systick
+ * @param value: value of the track
+ * @return true if the track is finished
+ ******************************************************************************/
+static bool LightTimeline_Evaluate(timeline_track_t *track, uint32_t date_ms, int32_t *value)
+{
+    const timeline_key_t *keys = track->keys;
+    uint32_t duration          = keys[track->key_nb - 1].date_ms;
+    uint32_t elapsed           = date_ms - track->start_date;
+
+    if (elapsed >= duration)
+    {
+        if (!track->loop || (duration == 0))
+        {
+            // Stay on the last key
+            *value = keys[track->key_nb - 1].value;
+            return !track->loop;
+        }
+        // Start the track again, the loop is usually passed once so a subtraction is cheaper than a division
+        while (elapsed >= duration)
+        {
+            track->start_date += duration;
+            elapsed -= duration;
+        }
+        track->next_key = 1;
+    }
+    if ((track->key_nb == 1) || (elapsed <= keys[0].date_ms))
+    {
+        *value = keys[0].value;
+        return false;
+    }
+    // Tracks go forward, the segment is searched from the previous one
+    while (elapsed >= keys[track->next_key].date_ms)
+    {
+        track->next_key++;
+    }
+    const timeline_key_t *from = &keys[track->next_key - 1];
+    const timeline_key_t *to   = &keys[track->next_key];
+    int32_t ratio              = (int32_t)(((uint64_t)(elapsed - from->date_ms) << 16) / (to->date_ms - from->date_ms));
+    *value                     = from->value + (int32_t)(((int64_t)(to->value - from->value) * LightTimeline_Ease(to->ease, ratio)) >> 16);
+    return false;
+}
+
+/******************************************************************************
+ * @brief Apply an easing curve
+ * @param ease: timeline_ease_t curve
+ * @param ratio: progress in the segment between 0 and EASE_ONE
+ * @return eased progress between 0 and EASE_ONE
+ ******************************************************************************/
+static int32_t LightTimeline_Ease(uint8_t ease, int32_t ratio)
+{
+    int64_t r = ratio;
+    switch (ease)
+    {
+        case TIMELINE_EASE_IN:
+            // r²
+            return (int32_t)((r * r) >> 16);
+        case TIMELINE_EASE_OUT:
+            // r × (2 - r)
+            return (int32_t)((r * (2 * EASE_ONE - r)) >> 16);
+        case TIMELINE_EASE_IN_OUT:
+            // smoothstep r² × (3 - 2r)
+            return (int32_t)((((r * r) >> 16) * (3 * EASE_ONE - 2 * r)) >> 16);
+        case TIMELINE_EASE_STEP:
+            return (ratio >= EASE_ONE) ? EASE_ONE : 0;
+        case TIMELINE_EASE_LINEAR:
+        default:
+            return ratio;
+    }
+}
+
+/******************************************************************************
+ * @brief Remove an active track, the last one takes its place
+ * @param index: track to remove
+ * @return None
+ ******************************************************************************/
+static void LightTimeline_Remove(uint8_t index)
+{
+    track_nb--;
+    tracks[index] = tracks[track_nb];
+}
@@ -0,0 +1,58 @@
+/******************************************************************************
+ * @file light timeline
+ * @brief keyframe animation of the light parameters
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#ifndef LIGHT_TIMELINE_H
+#define LIGHT_TIMELINE_H
+
+#include "luos_engine.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define TIMELINE_TRACK_NB 12 // tracks played at the same time, enough to move every parameter of 3 spots
+
+typedef enum
+{
+    TIMELINE_ANGLE,     // angular position of the spot in 1/100 degree
+    TIMELINE_RADIUS,    // radius of the spot in mm
+    TIMELINE_INTENSITY, // intensity of the spot in 1/100 percent
+    TIMELINE_KELVIN,    // color temperature of the spot in Kelvin
+    TIMELINE_CHANNEL_NB
+} timeline_channel_t;
+
+typedef enum
+{
+    TIMELINE_EASE_LINEAR, // constant speed
+    TIMELINE_EASE_IN,     // start slowly
+    TIMELINE_EASE_OUT,    // stop slowly
+    TIMELINE_EASE_IN_OUT, // start and stop slowly
+    TIMELINE_EASE_STEP,   // keep the previous value up to the key
+} timeline_ease_t;
+
+typedef struct
+{
+    uint32_t date_ms; // date of the key from the start of the track
+    int32_t value;    // value of the channel at this date
+    uint8_t ease;     // timeline_ease_t curve used to reach this key from the previous one
+} timeline_key_t;
+
+// Called with the value of each active track
+typedef void (*TIMELINE_APPLY)(uint8_t spot, timeline_channel_t channel, int32_t value);
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+void LightTimeline_Init(void);
+bool LightTimeline_Play(uint8_t spot, timeline_channel_t channel, const timeline_key_t *keys, uint8_t key_nb, bool loop, uint32_t date_ms);
+void LightTimeline_Stop(uint8_t spot);
+bool LightTimeline_IsPlaying(void);
+void LightTimeline_Update(uint32_t date_ms, TIMELINE_APPLY apply);
+
+#endif /* LIGHT_TIMELINE_H */
@@ -0,0 +1,198 @@
+/******************************************************************************
+ * @file light timing
+ * @brief frame time budget measurement of the light controler
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#include "main.h"
+#include "light_timing.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+typedef struct
+{
+    uint32_t min_us; // shortest measure since the last report
+    uint32_t max_us; // longest measure since the last report
+    uint32_t sum_us; // sum of the measures since the last report
+    uint16_t nb;     // number of measures since the last report
+} timing_stat_ctx_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+static timing_stat_ctx_t stats[TIMING_STAGE_NB];
+static uint32_t stage_start_us[TIMING_STAGE_NB];
+// Time spent in each stage during the current frame
+static uint32_t frame_stage_us[TIMING_STAGE_NB];
+static bool in_frame            = false;
+static uint32_t frame_start_us  = 0;
+static bool frame_started       = false;
+static uint32_t budget          = 0;
+static uint16_t missed_deadline = 0;
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+static uint32_t LightTiming_Now(void);
+static void LightTiming_Record(timing_stage_t stage, uint32_t elapsed_us);
+static void LightTiming_Reset(void);
+
+/******************************************************************************
+ * @brief init the measures
+ * @param budget_us: time available for each frame
+ * @return None
+ ******************************************************************************/
+void LightTiming_Init(uint32_t budget_us)
+{
+    budget          = budget_us;
+    missed_deadline = 0;
+    frame_started   = false;
+    in_frame        = false;
+    LightTiming_Reset();
+}
+
+/******************************************************************************
+ * @brief start measuring a frame
+ * @param None
+ * @return None
+ ******************************************************************************/
+void LightTiming_FrameStart(void)
+{
+    uint32_t now = LightTiming_Now();
+    // A frame starting more than a period late skipped at least one deadline
+    if (frame_started && (now - frame_start_us >= 2 * budget))
+    {
+        missed_deadline++;
+    }
+    frame_started  = true;
+    frame_start_us = now;
+    in_frame       = true;
+    memset(frame_stage_us, 0, sizeof(frame_stage_us));
+}
+
+/******************************************************************************
+ * @brief stop measuring a frame and record the time spent in each stage
+ * @param None
+ * @return None
+ ******************************************************************************/
+void LightTiming_FrameEnd(void)
+{
+    uint32_t total_us = LightTiming_Now() - frame_start_us;
+    in_frame          = false;
+    if (total_us > budget)
+    {
+        missed_deadline++;
+    }
+    // Everything not measured as render, send or log is the filtering of the inputs
+    uint32_t measured_us = frame_stage_us[TIMING_RENDER] + frame_stage_us[TIMING_SEND] + frame_stage_us[TIMING_LOG];
+    LightTiming_Record(TIMING_FILTER, (total_us > measured_us) ? total_us - measured_us : 0);
+    LightTiming_Record(TIMING_RENDER, frame_stage_us[TIMING_RENDER]);
+    LightTiming_Record(TIMING_SEND, frame_stage_us[TIMING_SEND]);
+    LightTiming_Record(TIMING_LOG, frame_stage_us[TIMING_LOG]);
+    LightTiming_Record(TIMING_FRAME, total_us);
+}
+
+/******************************************************************************
+ * @brief start measuring a stage
+ * @param stage: stage to measure
+ * @return None
+ ******************************************************************************/
+void LightTiming_StageStart(timing_stage_t stage)
+{
+    stage_start_us[stage] = LightTiming_Now();
+}
+
+/******************************************************************************
+ * @brief stop measuring a stage, it is recorded at the end of the frame if any
+ * @param stage: stage measured
+ * @return None
+ ******************************************************************************/
+void LightTiming_StageEnd(timing_stage_t stage)
+{
+    uint32_t elapsed_us = LightTiming_Now() - stage_start_us[stage];
+    if (in_frame)
+    {
+        frame_stage_us[stage] += elapsed_us;
+    }
+    else
+    {
+        LightTiming_Record(stage, elapsed_us);
+    }
+}
+
+/******************************************************************************
+ * @brief get the statistics since the last report and start new ones
+ * @param report: statistics to fill
+ * @return None
+ ******************************************************************************/
+void LightTiming_Report(timing_report_t *report)
+{
+    for (uint8_t stage = 0; stage < TIMING_STAGE_NB; stage++)
+    {
+        timing_stat_ctx_t *stat = &stats[stage];
+        // Measures are saturated to fit in the report
+        report->stage[stage].min_us = (stat->nb == 0) ? 0 : ((stat->min_us > 0xFFFF) ? 0xFFFF : stat->min_us);
+        report->stage[stage].max_us = (stat->max_us > 0xFFFF) ? 0xFFFF : stat->max_us;
+        report->stage[stage].avg_us = (stat->nb == 0) ? 0 : ((stat->sum_us / stat->nb > 0xFFFF) ? 0xFFFF : stat->sum_us / stat->nb);
+    }
+    report->frame_nb        = stats[TIMING_FRAME].nb;
+    report->missed_deadline = missed_deadline;
+    LightTiming_Reset();
+}
+
+/******************************************************************************
+ * @brief get the time from the SysTick counter
+ * @param None
+ * @return time in us, wrapping around
+ ******************************************************************************/
+static uint32_t LightTiming_Now(void)
+{
+    uint32_t tick_ms;
+    uint32_t counter;
+    // Read again if the millisecond tick changed while reading the counter
+    do
+    {
+        tick_ms = Luos_GetSystick();
+        counter = SysTick->VAL;
+    } while (tick_ms != Luos_GetSystick());
+    // SysTick count down from LOAD to 0 each millisecond
+    return tick_ms * 1000 + ((SysTick->LOAD - counter) * 1000) / (SysTick->LOAD + 1);
+}
+
+/******************************************************************************
+ * @brief add a measure to the statistics of a stage
+ * @param stage: stage measured
+ * @param elapsed_us: time spent in the stage
+ * @return None
+ ******************************************************************************/
+static void LightTiming_Record(timing_stage_t stage, uint32_t elapsed_us)
+{
+    timing_stat_ctx_t *stat = &stats[stage];
+    if (stat->nb == 0xFFFF)
+    {
+        // Too many measures without report, start again
+        memset(stat, 0, sizeof(timing_stat_ctx_t));
+    }
+    if ((stat->nb == 0) || (elapsed_us < stat->min_us))
+    {
+        stat->min_us = elapsed_us;
+    }
+    if (elapsed_us > stat->max_us)
+    {
+        stat->max_us = elapsed_us;
+    }
+    stat->sum_us += elapsed_us;
+    stat->nb++;
+}
+
+/******************************************************************************
+ * @brief start new statistics
+ * @param None
+ * @return None
+ ******************************************************************************/
+static void LightTiming_Reset(void)
+{
+    memset(stats, 0, sizeof(stats));
+    missed_deadline = 0;
+}
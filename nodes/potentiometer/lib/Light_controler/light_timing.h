@@ -0,0 +1,31 @@
+/******************************************************************************
+ * @file light timing
+ * @brief frame time budget measurement of the light controler
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#ifndef LIGHT_TIMING_H
+#define LIGHT_TIMING_H
+
+#include "luos_engine.h"
+#include "product_config.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+void LightTiming_Init(uint32_t budget_us);
+void LightTiming_FrameStart(void);
+void LightTiming_FrameEnd(void);
+void LightTiming_StageStart(timing_stage_t stage);
+void LightTiming_StageEnd(timing_stage_t stage);
+void LightTiming_Report(timing_report_t *report);
+
+#endif /* LIGHT_TIMING_H */
@@ -0,0 +1,145 @@
+/******************************************************************************
+ * @file light tx
+ * @brief outbound message queue of the light controler
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#include "light_tx.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+typedef struct
+{
+    bool used;                  // the entry contains a message to send
+    uint8_t priority;           // tx_priority_t of the message
+    uint16_t order;             // push order, the oldest message of a priority is sent first
+    header_t header;            // header of the message
+    uint8_t data[TX_DATA_SIZE]; // data of the message
+} tx_entry_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+static tx_entry_t queue[TX_QUEUE_SIZE];
+static uint16_t push_order = 0;
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+static tx_entry_t *LightTx_Next(void);
+
+/******************************************************************************
+ * @brief init the queue empty
+ * @param None
+ * @return None
+ ******************************************************************************/
+void LightTx_Init(void)
+{
+    memset(queue, 0, sizeof(queue));
+    push_order = 0;
+}
+
+/******************************************************************************
+ * @brief Queue a message, it replaces a queued message with the same target and command
+ * @param msg: message to send
+ * @param priority: priority of the message
+ * @return false if the message can't be queued
+ ******************************************************************************/
+bool LightTx_Push(const msg_t *msg, tx_priority_t priority)
+{
+    if (msg->header.size > TX_DATA_SIZE)
+    {
+        return false;
+    }
+    tx_entry_t *entry = NULL;
+    tx_entry_t *lower = NULL;
+    for (uint8_t i = 0; i < TX_QUEUE_SIZE; i++)
+    {
+        if (!queue[i].used)
+        {
+            entry = (entry == NULL) ? &queue[i] : entry;
+        }
+        else if ((queue[i].header.target == msg->header.target) && (queue[i].header.target_mode == msg->header.target_mode)
+                 && (queue[i].header.cmd == msg->header.cmd))
+        {
+            // Only the last value is useful, update the queued message in place
+            queue[i].header   = msg->header;
+            queue[i].priority = (priority > queue[i].priority) ? priority : queue[i].priority;
+            memcpy(queue[i].data, msg->data, msg->header.size);
+            return true;
+        }
+        else if ((queue[i].priority < priority) && ((lower == NULL) || (queue[i].priority < lower->priority)))
+        {
+            lower = &queue[i];
+        }
+    }
+    if (entry == NULL)
+    {
+        // The queue is full, drop a less important message
+        entry = lower;
+    }
+    if (entry == NULL)
+    {
+        return false;
+    }
+    entry->used     = true;
+    entry->priority = priority;
+    entry->order    = push_order++;
+    entry->header   = msg->header;
+    memcpy(entry->data, msg->data, msg->header.size);
+    return true;
+}
+
+/******************************************************************************
+ * @brief Send the queued messages while Luos accept them, must be call in the project loop
+ * @param service: service sending the messages
+ * @return None
+ ******************************************************************************/
+void LightTx_Loop(service_t *service)
+{
+    tx_entry_t *entry = LightTx_Next();
+    while (entry != NULL)
+    {
+        msg_t msg;
+        msg.header = entry->header;
+        memcpy(msg.data, entry->data, entry->header.size);
+        if (Luos_SendMsg(service, &msg) != SUCCEED)
+        {
+            // Luos buffers are full, try again on the next loop
+            return;
+        }
+        entry->used = false;
+        entry       = LightTx_Next();
+    }
+}
+
+/******************************************************************************
+ * @brief Check if every queued message have been sent
+ * @param None
+ * @return true if the queue is empty
+ ******************************************************************************/
+bool LightTx_IsEmpty(void)
+{
+    return (LightTx_Next() == NULL);
+}
+
+/******************************************************************************
+ * @brief Find the next message to send
+ * @param None
+ * @return oldest message of the highest priority, NULL if the queue is empty
+ ******************************************************************************/
+static tx_entry_t *LightTx_Next(void)
+{
+    tx_entry_t *next = NULL;
+    for (uint8_t i = 0; i < TX_QUEUE_SIZE; i++)
+    {
+        if (queue[i].used
+            && ((next == NULL) || (queue[i].priority > next->priority)
+                || ((queue[i].priority == next->priority) && ((int16_t)(queue[i].order - next->order) < 0))))
+        {
+            next = &queue[i];
+        }
+    }
+    return next;
+}
@@ -0,0 +1,37 @@
+/******************************************************************************
+ * @file light tx
+ * @brief outbound message queue of the light controler
+ * @author Luos
+ * @version 0.0.0
+ ******************************************************************************/
+#ifndef LIGHT_TX_H
+#define LIGHT_TX_H
+
+#include "luos_engine.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define TX_QUEUE_SIZE 6  // messages waiting to be sent
+#define TX_DATA_SIZE  32 // biggest message that can be queued
+
+typedef enum
+{
+    TX_PRIORITY_FRAME,  // frame flow, sent once everything else is gone
+    TX_PRIORITY_REPLY,  // answers to requests
+    TX_PRIORITY_CONFIG, // configuration of the other services
+} tx_priority_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function
+ ******************************************************************************/
+void LightTx_Init(void);
+bool LightTx_Push(const msg_t *msg, tx_priority_t priority);
+void LightTx_Loop(service_t *service);
+bool LightTx_IsEmpty(void);
+
+#endif /* LIGHT_TX_H */
@@ -31,6 +31,8 @@
 /*******************************************************************************
  * PROJECT DEFINITION
  *******************************************************************************/
+#define LOG_FLASH_ADDRESS    0x0801E000 // 2 flash pages of the light state log
+#define PRESET_FLASH_ADDRESS 0x0801F000 // flash page of the scene presets, the last one is used by Luos
 
 /*******************************************************************************
  * LUOS LIBRARY DEFINITION
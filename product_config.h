@@ -7,11 +7,115 @@
 #ifndef PRODUCT_CONFIG_H
 #define PRODUCT_CONFIG_H
 
-#include "luos.h"
+#include "luos_engine.h"
 
 typedef enum
 {
     LIGHT_CONTROLER_APP = LUOS_LAST_TYPE
 } desk_t;
 
+typedef enum
+{
+    FRAME_COMMIT = LUOS_LAST_STD_CMD, // broadcasted to display the staged frame of all led strips at once
+    EFFECT_PROGRAM,                   // bytecode program computing an effect directly on the led strip
+    COLOR_FRAME,                      // frame_header_t followed by span_nb frame_span_t, each one followed by its led colors
+    FRAME_ACK,                        // frame_ack_t sent back by a led strip each time it display a COLOR_FRAME
+    SPOT_KERNEL,                      // uint8_t falloff shape of the controlled spot, see render_kernel_t
+    SPOT_SELECT,                      // uint8_t index of the spot controlled by the desk
+    FRAME_TIMING,                     // timing_report_t sent by the light controler on GET_CMD
+    STRIP_GEOMETRY,                   // asked to a led strip, it answer with its strip_geometry_t
+    ANIMATION_PLAY,                   // animation_cmd_t animation to play on a spot of the light controler
+    PRESET_SAVE,                      // uint8_t index of the preset to store the current scene of the light controler in
+    PRESET_RECALL,                    // uint8_t index of the preset the light controler have to go to
+    LIGHT_SET,                        // light_set_t parameter of a spot of the light controler to set directly
+} desk_cmd_t;
+
+// Maximum number of spans in a COLOR_FRAME
+#define FRAME_MAX_SPAN 4
+// Sequence number of the first frame sent after a restart or a detection, the led strips start a new sequence on it
+#define FRAME_SEQ_FIRST 1
+
+typedef struct __attribute__((__packed__))
+{
+    uint16_t seq;    // sequence number, incremented for each new frame
+    uint8_t span_nb; // number of spans following this header
+} frame_header_t;
+
+typedef struct __attribute__((__packed__))
+{
+    uint16_t first_led; // first led updated by this span
+    uint16_t led_nb;    // number of led colors following this span
+} frame_span_t;
+
+typedef struct __attribute__((__packed__))
+{
+    uint16_t last_seq;     // sequence number of the last frame displayed
+    uint16_t dropped;      // frames replaced before being displayed or not completely received
+    uint16_t out_of_order; // frames received after a newer one and ignored
+} frame_ack_t;
+
+typedef struct __attribute__((__packed__))
+{
+    uint16_t led_nb;           // number of led of the strip
+    uint16_t length_mm;        // length of the strip
+    uint16_t first_angle_cdeg; // angular position of the strip start in 1/100 degree
+    uint16_t angle_cdeg;       // angle covered by the strip in 1/100 degree, 0 to share the scene evenly between strips
+} strip_geometry_t;
+
+typedef enum
+{
+    ANIMATION_STOP,      // stop the animations of the spot where they are
+    ANIMATION_SUNRISE,   // slowly grow and warm up the spot to a full intensity daylight
+    ANIMATION_BREATHING, // slowly pulse the intensity of the spot until stopped
+    ANIMATION_NB
+} light_animation_t;
+
+typedef struct __attribute__((__packed__))
+{
+    uint8_t spot;      // spot to animate
+    uint8_t animation; // light_animation_t to play
+} animation_cmd_t;
+
+typedef enum
+{
+    LIGHT_ANGLE,     // angular position of the spot in 1/100 degree
+    LIGHT_RADIUS,    // radius of the spot in mm
+    LIGHT_INTENSITY, // intensity of the spot in 1/100 percent
+    LIGHT_KELVIN,    // color temperature of the spot in Kelvin
+    LIGHT_CHANNEL_NB
+} light_channel_t;
+
+typedef struct __attribute__((__packed__))
+{
+    uint8_t spot;         // spot to set
+    uint8_t channel;      // light_channel_t parameter to set
+    int32_t value;        // value to reach in the unit of the channel
+    uint16_t duration_ms; // duration of the transition, 0 to apply the value at once
+    uint8_t ease;         // curve of the transition: 0 linear, 1 ease in, 2 ease out, 3 ease in and out
+} light_set_t;
+
+typedef enum
+{
+    TIMING_FILTER, // inputs filtering and everything else done in a frame
+    TIMING_RENDER, // picture rendering and compositing
+    TIMING_SEND,   // frame building and sending
+    TIMING_LOG,    // light state logging in flash
+    TIMING_FRAME,  // whole frame
+    TIMING_STAGE_NB
+} timing_stage_t;
+
+typedef struct __attribute__((__packed__))
+{
+    uint16_t min_us;
+    uint16_t max_us;
+    uint16_t avg_us;
+} timing_stat_t;
+
+typedef struct __attribute__((__packed__))
+{
+    timing_stat_t stage[TIMING_STAGE_NB]; // time spent in each timing_stage_t since the last report
+    uint16_t frame_nb;                    // frames measured since the last report
+    uint16_t missed_deadline;             // frames longer than their period or started late since the last report
+} timing_report_t;
+
 #endif /* PRODUCT_CONFIG_H */
\ No newline at end of file